@@ -74,6 +74,8 @@ class CoreExport AccessProvider : public Service
 class CoreExport ChanAccess : public Serializable
 {
 	Anope::string mask;
+	/* mask compiled for matching users against */
+	Anope::Glob glob;
 	/* account this access entry is for, if any */
 	Serialize::Reference<NickCore> nc;
 
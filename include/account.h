@@ -34,12 +34,12 @@ class CoreExport NickAlias : public Serializable, public Extensible
 
  public:
 	Anope::string nick;
-	Anope::string last_quit;
-	Anope::string last_realname;
+	Anope::InternedString last_quit;
+	Anope::InternedString last_realname;
 	/* Last usermask this nick was seen on, eg user@host */
-	Anope::string last_usermask;
+	Anope::InternedString last_usermask;
 	/* Last uncloaked usermask, requires nickserv/auspex to see */
-	Anope::string last_realhost;
+	Anope::InternedString last_realhost;
 	time_t time_registered;
 	time_t last_seen;
 	/* Account this nick is tied to. Multiple nicks can be tied to a single account. */
@@ -74,9 +74,9 @@ namespace Anope
 		inline bool equals_cs(const std::string &_str) const { return this->_string == _str; }
 		inline bool equals_cs(const string &_str) const { return this->_string == _str._string; }
 
-		inline bool equals_ci(const char *_str) const { return ci::string(this->_string.c_str()) == _str; }
-		inline bool equals_ci(const std::string &_str) const { return ci::string(this->_string.c_str()) == _str.c_str(); }
-		inline bool equals_ci(const string &_str) const { return ci::string(this->_string.c_str()) == _str._string.c_str(); }
+		inline bool equals_ci(const char *_str) const { return ci::equals(this->_string.c_str(), this->_string.length(), _str, strlen(_str)); }
+		inline bool equals_ci(const std::string &_str) const { return ci::equals(this->_string.c_str(), this->_string.length(), _str.c_str(), _str.length()); }
+		inline bool equals_ci(const string &_str) const { return ci::equals(this->_string.c_str(), this->_string.length(), _str._string.c_str(), _str._string.length()); }
 
 		/**
 		 * Inequality operators, exact opposites of the above.
@@ -312,7 +312,7 @@ namespace Anope
 	{
 		inline size_t operator()(const string &s) const
 		{
-			return TR1NS::hash<std::string>()(s.lower().str());
+			return ci::hash(s.c_str(), s.length());
 		}
 	};
 
@@ -336,6 +336,91 @@ namespace Anope
 	template<typename T> class multimap : public std::multimap<string, T, ci::less> { };
 	template<typename T> class hash_map : public TR1NS::unordered_map<string, T, hash_ci, compare> { };
 
+	/** A string which shares its memory with every other interned string with
+	 * the same contents. This is used for data which is often the same for many
+	 * objects, such as users' hostnames and realnames. The contents can not be
+	 * modified in place, only replaced.
+	 */
+	class CoreExport InternedString
+	{
+		typedef TR1NS::unordered_map<string, unsigned, hash_cs> Pool;
+		typedef Pool::value_type Entry;
+
+		/* Every interned string, and how many InternedStrings refer to it */
+		static Pool pool;
+		/* The entry in the pool, or NULL if this is empty */
+		Entry *entry;
+
+		static Entry *Acquire(const string &str);
+		static void Release(Entry *e);
+
+	 public:
+		InternedString() : entry(NULL) { }
+		InternedString(const string &str) : entry(Acquire(str)) { }
+		InternedString(const char *str) : entry(Acquire(str)) { }
+		InternedString(const InternedString &other) : entry(other.entry)
+		{
+			if (entry)
+				++entry->second;
+		}
+
+		~InternedString()
+		{
+			Release(entry);
+		}
+
+		InternedString &operator=(const InternedString &other)
+		{
+			if (other.entry)
+				++other.entry->second;
+			Release(entry);
+			entry = other.entry;
+			return *this;
+		}
+
+		inline InternedString &operator=(const string &str) { return *this = InternedString(str); }
+		inline InternedString &operator=(const char *str) { return *this = InternedString(str); }
+
+		/** Get the contents of this string
+		 */
+		const string &get() const;
+		inline operator const string &() const { return get(); }
+
+		inline const char *c_str() const { return get().c_str(); }
+		inline void clear() { Release(entry); entry = NULL; }
+		inline bool empty() const { return entry == NULL; }
+		inline string::size_type length() const { return get().length(); }
+
+		inline bool equals_ci(const string &_str) const { return get().equals_ci(_str); }
+		inline bool equals_cs(const string &_str) const { return entry ? entry->first.equals_cs(_str) : _str.empty(); }
+		inline bool operator==(const string &_str) const { return equals_cs(_str); }
+		inline bool operator==(const char *_str) const { return get() == _str; }
+		inline bool operator==(const InternedString &other) const { return entry == other.entry; }
+		inline bool operator!=(const string &_str) const { return !equals_cs(_str); }
+		inline bool operator!=(const char *_str) const { return get() != _str; }
+		inline bool operator!=(const InternedString &other) const { return entry != other.entry; }
+
+		inline const string operator+(char chr) const { return get() + chr; }
+		inline const string operator+(const char *_str) const { return get() + _str; }
+		inline const string operator+(const string &_str) const { return get() + _str; }
+
+		/** Get statistics about the pool of interned strings
+		 * @param strings Set to the number of distinct strings
+		 * @param references Set to the number of InternedStrings referring to them
+		 * @param saved Set to the number of bytes which would be used by duplicate copies
+		 */
+		static void GetStats(size_t &strings, size_t &references, size_t &saved);
+	};
+
+	inline std::ostream &operator<<(std::ostream &os, const InternedString &_str) { return os << _str.get(); }
+	inline std::istream &operator>>(std::istream &is, InternedString &_str)
+	{
+		string tmp;
+		is >> tmp;
+		_str = tmp;
+		return is;
+	}
+
 #ifndef REPRODUCIBLE_BUILD
 	static const char *const compiled = __TIME__ " " __DATE__;
 #endif
@@ -358,6 +443,11 @@ namespace Anope
 	 */
 	extern CoreExport time_t CurTime;
 
+	/** Get the current time in microseconds. This is meant for measuring how
+	 * long something takes, use CurTime for everything else.
+	 */
+	extern CoreExport uint64_t MicroTime();
+
 	/** The debug level we are running at.
 	 */
 	extern CoreExport int Debug;
@@ -430,6 +520,63 @@ namespace Anope
 	 */
 	extern CoreExport bool Match(const string &str, const string &mask, bool case_sensitive = false, bool use_regex = false);
 
+	/** A wildcard mask, as used by Match(), compiled for matching many strings
+	 * against. The mask is split into the literal segments between its '*'s,
+	 * which lets impossible strings be rejected by their length and the first
+	 * and last segments before searching for the others.
+	 */
+	class CoreExport Glob
+	{
+		string mask;
+		bool case_sensitive;
+		/* The mask between each '*' */
+		std::vector<string> segments;
+		/* Whether the mask starts or ends with '*' */
+		bool leading_star, trailing_star;
+		/* The shortest string which can match */
+		size_t min_length;
+
+		bool MatchSegment(const char *str, const string &segment) const;
+		size_t FindSegment(const char *str, size_t start, size_t end, const string &segment) const;
+
+	 public:
+		Glob();
+
+		/** Constructor
+		 * @param mask The mask, eg foo*bar
+		 * @param case_sensitive Whether matching is case sensitive
+		 */
+		Glob(const string &mask, bool case_sensitive = false);
+
+		/** Compile a new mask, replacing the current one
+		 * @param mask The mask, eg foo*bar
+		 * @param case_sensitive Whether matching is case sensitive
+		 */
+		void Compile(const string &mask, bool case_sensitive = false);
+
+		/** Check whether a string matches this mask. This gives the same result as Match() without regex.
+		 */
+		bool Matches(const string &str) const;
+
+		inline const string &GetMask() const { return mask; }
+
+		/** Check if this mask has no wildcards, in which case only strings equal to it will match
+		 */
+		inline bool IsLiteral() const { return !leading_star && !trailing_star && segments.size() == 1 && segments[0].find('?') == string::npos; }
+	};
+
+	/** Frees the compiled regular expressions kept by Match(). This is done
+	 * automatically when the configuration is reloaded.
+	 */
+	extern CoreExport void FlushRegexCache();
+
+	/** Get statistics about the compiled regular expressions kept by Match()
+	 * @param entries Set to the number of regular expressions kept
+	 * @param hits Set to how many times a kept regular expression was used
+	 * @param misses Set to how many times a regular expression had to be compiled
+	 */
+	extern CoreExport void GetRegexCacheStats(size_t &entries, uint64_t &hits, uint64_t &misses);
+
 	/** Converts a string to hex
 	 * @param the data to be converted
 	 * @return a anope::string containing the hex value
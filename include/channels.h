@@ -18,7 +18,11 @@ typedef Anope::hash_map<Channel *> channel_map;
 
 extern CoreExport channel_map ChannelList;
 
-/* A user container, there is one of these per user per channel. */
+/* A user container, there is one of these per user per channel.
+ * It is linked directly into both the channel's list of users and the
+ * user's list of channels, and into the index used to find it by user
+ * and channel, so joining and parting allocate nothing else.
+ */
 struct ChanUserContainer : public Extensible
 {
 	User *user;
@@ -26,7 +30,99 @@ struct ChanUserContainer : public Extensible
 	/* Status the user has in the channel */
 	ChannelStatus status;
 
-	ChanUserContainer(User *u, Channel *c) : user(u), chan(c) { }
+	/* Links to the neighbouring containers, see ChanUserContainerList */
+	ChanUserContainer *prev[2], *next[2];
+	/* The next container in the same bucket of the membership index, see channels.cpp */
+	ChanUserContainer *hash_next;
+
+	ChanUserContainer(User *u, Channel *c) : user(u), chan(c), hash_next(NULL)
+	{
+		prev[0] = prev[1] = next[0] = next[1] = NULL;
+	}
+};
+
+/** A list of ChanUserContainers linked through the containers themselves.
+ * Link 0 is used for a channel's users and link 1 for a user's channels.
+ * Removing a container only invalidates iterators to that container.
+ */
+template<int Link> class ChanUserContainerList
+{
+	ChanUserContainer *head, *tail;
+	size_t count;
+
+	ChanUserContainerList(const ChanUserContainerList &);
+	ChanUserContainerList &operator=(const ChanUserContainerList &);
+
+ public:
+	class iterator
+	{
+		const ChanUserContainerList *list;
+		ChanUserContainer *cur;
+
+	 public:
+		typedef std::bidirectional_iterator_tag iterator_category;
+		typedef ChanUserContainer *value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef ChanUserContainer *const *pointer;
+		typedef ChanUserContainer *reference;
+
+		iterator() : list(NULL), cur(NULL) { }
+		iterator(const ChanUserContainerList *l, ChanUserContainer *c) : list(l), cur(c) { }
+
+		inline ChanUserContainer *operator*() const { return cur; }
+
+		inline iterator &operator++() { cur = cur->next[Link]; return *this; }
+		inline iterator operator++(int) { iterator tmp = *this; ++*this; return tmp; }
+		inline iterator &operator--() { cur = cur ? cur->prev[Link] : list->tail; return *this; }
+		inline iterator operator--(int) { iterator tmp = *this; --*this; return tmp; }
+
+		inline bool operator==(const iterator &other) const { return cur == other.cur; }
+		inline bool operator!=(const iterator &other) const { return cur != other.cur; }
+	};
+	typedef iterator const_iterator;
+	typedef std::reverse_iterator<iterator> reverse_iterator;
+	typedef reverse_iterator const_reverse_iterator;
+
+	ChanUserContainerList() : head(NULL), tail(NULL), count(0) { }
+
+	inline iterator begin() const { return iterator(this, head); }
+	inline iterator end() const { return iterator(this, NULL); }
+	inline reverse_iterator rbegin() const { return reverse_iterator(end()); }
+	inline reverse_iterator rend() const { return reverse_iterator(begin()); }
+
+	inline ChanUserContainer *front() const { return head; }
+	inline size_t size() const { return count; }
+	inline bool empty() const { return count == 0; }
+
+	/** Add a container to the end of the list
+	 */
+	void push_back(ChanUserContainer *cuc)
+	{
+		cuc->prev[Link] = tail;
+		cuc->next[Link] = NULL;
+		if (tail)
+			tail->next[Link] = cuc;
+		else
+			head = cuc;
+		tail = cuc;
+		++count;
+	}
+
+	/** Remove a container from the list. It must be in the list.
+	 */
+	void erase(ChanUserContainer *cuc)
+	{
+		if (cuc->prev[Link])
+			cuc->prev[Link]->next[Link] = cuc->next[Link];
+		else
+			head = cuc->next[Link];
+		if (cuc->next[Link])
+			cuc->next[Link]->prev[Link] = cuc->prev[Link];
+		else
+			tail = cuc->prev[Link];
+		cuc->prev[Link] = cuc->next[Link] = NULL;
+		--count;
+	}
 };
 
 class CoreExport Channel : public Base, public Extensible
@@ -39,6 +135,11 @@ class CoreExport Channel : public Base, public Extensible
 	/** A map of channel modes with their parameters set on this channel
 	 */
 	ModeList modes;
+	/** The entries of each list mode set on this channel, indexed for matching users
+	 */
+	std::map<Anope::string, ListModeMatcher *> list_matchers;
+
+	void ClearListMatchers();
 
  public:
 	/* Channel name */
@@ -53,7 +154,7 @@ class CoreExport Channel : public Base, public Extensible
 	bool botchannel;
 
 	/* Users in the channel */
-	typedef std::map<User *, ChanUserContainer *> ChanUserList;
+	typedef ChanUserContainerList<0> ChanUserList;
 	ChanUserList users;
 
 	/* Current topic of the channel */
@@ -221,6 +322,12 @@ class CoreExport Channel : public Base, public Extensible
 	 */
 	bool MatchesList(User *u, const Anope::string &list);
 
+	/** Get the entries of a list mode indexed for matching users
+	 * @param list The mode of the list
+	 * @return The entries, or NULL if none of this mode are set
+	 */
+	const ListModeMatcher *GetListMatcher(const Anope::string &list) const;
+
 	/** Kick a user from a channel internally
 	 * @param source The sender of the kick
 	 * @param nick The nick being kicked
@@ -101,6 +101,12 @@ namespace Configuration
 		Anope::string DefLanguage;
 		/* options:timeoutcheck */
 		time_t TimeoutCheck;
+		/* options:uplinkflushsize */
+		unsigned UplinkFlushSize;
+		/* options:slowhookthreshold, in milliseconds */
+		unsigned SlowHookThreshold;
+		/* options:stallthreshold, in milliseconds */
+		unsigned StallThreshold;
 		/* options:usestrictprivmsg */
 		bool UseStrictPrivmsg;
 		/* networkinfo:nickchars */
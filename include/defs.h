@@ -29,6 +29,7 @@ class IdentifyRequest;
 class InfoFormatter;
 class IRCDProto;
 class ListenSocket;
+class ListModeMatcher;
 class Log;
 class Memo;
 class MessageSource;
@@ -41,6 +42,7 @@ class Regex;
 class Serializable;
 class Server;
 class Socket;
+class SocketBuffer;
 class Thread;
 class User;
 class XLine;
@@ -15,15 +15,47 @@
 #include "logger.h"
 
 class Extensible;
+class ExtensibleBase;
+
+/** An extension item which is set on an object
+ */
+struct ExtensibleEntry
+{
+	ExtensibleBase *item;
+	void *value;
+	/* The position of the object in the item's list of objects */
+	size_t index;
+};
 
 class CoreExport ExtensibleBase : public Service
 {
  protected:
-	std::map<Extensible *, void *> items;
+	/* The objects this item is set on. These are kept in a vector, rather than
+	 * a map from objects to values, as the values are kept in the objects.
+	 */
+	std::vector<Extensible *> objects;
 
 	ExtensibleBase(Module *m, const Anope::string &n);
 	~ExtensibleBase();
 
+	/** Find this item on an object
+	 * @param obj The object
+	 * @return The entry for this item, or NULL if it is not set on the object
+	 */
+	const ExtensibleEntry *Find(const Extensible *obj) const;
+
+	/** Set this item on an object, which must not already have it set
+	 * @param obj The object
+	 * @param value The value
+	 */
+	void Add(Extensible *obj, void *value);
+
+	/** Remove this item from an object, which must have it set
+	 * @param obj The object
+	 * @return The value it had
+	 */
+	void *Remove(Extensible *obj);
+
  public:
 	virtual void Unset(Extensible *obj) = 0;
 
@@ -35,8 +67,18 @@ class CoreExport ExtensibleBase : public Service
 class CoreExport Extensible
 {
  public:
-	std::set<ExtensibleBase *> extension_items;
-
+	/* The items set on this object. Objects rarely have more than a few, so
+	 * these are searched through rather than kept in a map.
+	 */
+	std::vector<ExtensibleEntry> extension_items;
+
+	Extensible() { }
+	/* The items set on an object are its own, and each entry holds the object's
+	 * position in the item, so a copy starts with no items set and assigning
+	 * to an object leaves the items set on it alone.
+	 */
+	Extensible(const Extensible &) { }
+	Extensible &operator=(const Extensible &) { return *this; }
 	virtual ~Extensible();
 
 	void UnsetExtensibles();
@@ -64,16 +106,8 @@ class BaseExtensibleItem : public ExtensibleBase
 
 	~BaseExtensibleItem()
 	{
-		while (!items.empty())
-		{
-			std::map<Extensible *, void *>::iterator it = items.begin();
-			Extensible *obj = it->first;
-			T *value = static_cast<T *>(it->second);
-
-			obj->extension_items.erase(this);
-			items.erase(it);
-			delete value;
-		}
+		while (!this->objects.empty())
+			delete static_cast<T *>(this->Remove(this->objects.back()));
 	}
 
 	T* Set(Extensible *obj, const T &value)
@@ -88,30 +122,27 @@ class BaseExtensibleItem : public ExtensibleBase
 	{
 		T* t = Create(obj);
 		Unset(obj);
-		items[obj] = t;
-		obj->extension_items.insert(this);
+		this->Add(obj, t);
 		return t;
 	}
 
 	void Unset(Extensible *obj) anope_override
 	{
-		T *value = Get(obj);
-		items.erase(obj);
-		obj->extension_items.erase(this);
-		delete value;
+		if (this->Find(obj))
+			delete static_cast<T *>(this->Remove(obj));
 	}
 
 	T* Get(const Extensible *obj) const
 	{
-		std::map<Extensible *, void *>::const_iterator it = items.find(const_cast<Extensible *>(obj));
-		if (it != items.end())
-			return static_cast<T *>(it->second);
+		const ExtensibleEntry *entry = this->Find(obj);
+		if (entry)
+			return static_cast<T *>(entry->value);
 		return NULL;
 	}
 
 	bool HasExt(const Extensible *obj) const
 	{
-		return items.find(const_cast<Extensible *>(obj)) != items.end();
+		return this->Find(obj) != NULL;
 	}
 
 	T* Require(Extensible *obj)
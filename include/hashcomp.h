@@ -29,9 +29,20 @@ namespace Anope
 	/* Casemap in use by Anope. ci::string's comparation functions use this (and thus Anope::string) */
 	extern std::locale casemap;
 
+	/* The case map in use as lookup tables, rebuilt by CaseMapRebuild() */
+	extern CoreExport unsigned char case_map_upper[256], case_map_lower[256];
+
 	extern void CaseMapRebuild();
-	extern unsigned char tolower(unsigned char);
-	extern unsigned char toupper(unsigned char);
+
+	inline unsigned char tolower(unsigned char c)
+	{
+		return case_map_lower[c];
+	}
+
+	inline unsigned char toupper(unsigned char c)
+	{
+		return case_map_upper[c];
+	}
 
 	/* ASCII case insensitive ctype. */
 	template<typename char_type>
@@ -131,6 +142,32 @@ namespace ci
 	 */
 	typedef std::basic_string<char, ci_char_traits, std::allocator<char> > string;
 
+	/** Compare two strings case insensitively, without copying them.
+	 * @param str1 First string
+	 * @param len1 Length of the first string
+	 * @param str2 Second string
+	 * @param len2 Length of the second string
+	 * @return Less than, equal to, or greater than zero, like ci::string::compare
+	 */
+	extern CoreExport int compare(const char *str1, size_t len1, const char *str2, size_t len2);
+
+	/** Check if two strings are equal case insensitively, without copying them.
+	 * @param str1 First string
+	 * @param len1 Length of the first string
+	 * @param str2 Second string
+	 * @param len2 Length of the second string
+	 * @return true if the strings are equal
+	 */
+	extern CoreExport bool equals(const char *str1, size_t len1, const char *str2, size_t len2);
+
+	/** Hash a string case insensitively, so strings which are equal
+	 * case insensitively hash to the same value.
+	 * @param str The string
+	 * @param len The length of the string
+	 * @return The hash
+	 */
+	extern CoreExport size_t hash(const char *str, size_t len);
+
 	struct CoreExport less
 	{
 		/** Compare two Anope::strings as ci::strings and find which one is less
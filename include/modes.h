@@ -11,6 +11,7 @@
 
 #include "anope.h"
 #include "base.h"
+#include "sockets.h"
 
 /** The different types of modes
 */
@@ -419,4 +420,65 @@ class CoreExport Entry
 	bool Matches(User *u, bool full = false) const;
 };
 
+/** The entries of one list mode on a channel, indexed so that checking
+ * whether a user matches any of them does not have to check every entry.
+ * Entries for a single host are found by hashing the user's hosts, CIDR
+ * entries by looking up the user's IP, entries for a single nick with any
+ * host by hashing the user's nick, and only the rest (wildcard masks,
+ * extbans, ident only masks) are checked one by one.
+ */
+class CoreExport ListModeMatcher
+{
+	Anope::string mode;
+	/* Every entry, by mask */
+	Anope::hash_map<Entry *> entries;
+	/* Entries for a host without wildcards, by host */
+	Anope::hash_map<std::vector<Entry *> > hosts;
+	/* Entries for a CIDR range */
+	cidr_trie<Entry *> ranges;
+	/* Entries for a nick without wildcards which are not in hosts or ranges, by nick */
+	Anope::hash_map<std::vector<Entry *> > nicks;
+	/* Entries which have to be checked individually */
+	std::vector<Entry *> wild;
+
+	ListModeMatcher(const ListModeMatcher &);
+	ListModeMatcher &operator=(const ListModeMatcher &);
+
+	void GetCandidates(User *u, std::vector<Entry *> &candidates) const;
+
+ public:
+	/** Constructor
+	 * @param mode The name of the list mode
+	 */
+	ListModeMatcher(const Anope::string &mode);
+	~ListModeMatcher();
+
+	/** Add an entry
+	 * @param mask The mask
+	 */
+	void Add(const Anope::string &mask);
+
+	/** Remove an entry
+	 * @param mask The mask, compared case insensitively
+	 */
+	void Del(const Anope::string &mask);
+
+	/** Check if any entry matches a user
+	 * @param u The user
+	 * @param full True to match against a users real host and IP
+	 * @return true on match
+	 */
+	bool Matches(User *u, bool full = false) const;
+
+	/** Get every entry which matches a user
+	 * @param u The user
+	 * @param full True to match against a users real host and IP
+	 * @param matches The masks of the matching entries are appended here
+	 */
+	void GetMatches(User *u, bool full, std::vector<Anope::string> &matches) const;
+
+	inline size_t size() const { return entries.size(); }
+	inline bool empty() const { return entries.empty(); }
+};
+
 #endif // MODES_H
@@ -83,7 +83,11 @@ if (true) \
 	{ \
 		try \
 		{ \
-			(*_i)->ename args; \
+			Module *_m = *_i; \
+			uint64_t _started = ModuleManager::ProfileHooks ? Anope::MicroTime() : 0; \
+			_m->ename args; \
+			if (_started) \
+				ModuleManager::ProfileEvent(_m, I_ ## ename, #ename, _started); \
 		} \
 		catch (const ModuleException &modexcept) \
 		{ \
@@ -117,7 +121,11 @@ if (true) \
 	{ \
 		try \
 		{ \
-			EventReturn res = (*_i)->ename args; \
+			Module *_m = *_i; \
+			uint64_t _started = ModuleManager::ProfileHooks ? Anope::MicroTime() : 0; \
+			EventReturn res = _m->ename args; \
+			if (_started) \
+				ModuleManager::ProfileEvent(_m, I_ ## ename, #ename, _started); \
 			if (res != EVENT_CONTINUE) \
 			{ \
 				ret = res; \
@@ -225,6 +233,18 @@ class ModuleVersion
 
 class NotImplementedException : public CoreException { };
 
+/** Statistics about the time spent in one module's handler for one event
+ */
+struct EventStats
+{
+	/* The name of the event */
+	const char *name;
+	/* Number of calls, and the total and longest time they took in microseconds */
+	uint64_t count, time, max;
+
+	EventStats() : name(NULL), count(0), time(0), max(0) { }
+};
+
 /** Every module in Anope is actually a class.
  */
 class CoreExport Module : public Extensible
@@ -260,6 +280,11 @@ class CoreExport Module : public Extensible
 	 */
 	Anope::string author;
 
+	/** Statistics about this module's event handlers, indexed by event.
+	 * These are only recorded when options:profilehooks is enabled.
+	 */
+	std::vector<EventStats> event_stats;
+
 	/** Creates and initialises a new module.
 	 * @param modname The module name
 	 * @param loadernick The nickname of the user loading the module.
@@ -1138,6 +1163,10 @@ class CoreExport ModuleManager
 	 */
 	static std::vector<Module *> EventHandlers[I_SIZE];
 
+	/** Whether the time spent in event handlers is being recorded
+	 */
+	static bool ProfileHooks;
+
 	/** List of all modules loaded in Anope
 	 */
 	static std::list<Module *> Modules;
@@ -1207,6 +1236,15 @@ class CoreExport ModuleManager
 	 */
 	static bool SetPriority(Module *mod, Priority s);
 
+	/** Record that a module has finished handling an event, used by FOREACH_MOD
+	 * and FOREACH_RESULT when ProfileHooks is set.
+	 * @param mod The module
+	 * @param i The event
+	 * @param name The name of the event
+	 * @param started When the module started handling the event, from Anope::MicroTime()
+	 */
+	static void ProfileEvent(Module *mod, Implementation i, const char *name, uint64_t started);
+
 	/** Detach all events from a module (used on unload)
 	 * @param mod Module to detach from
 	 */
@@ -66,5 +66,12 @@ struct BadWords
 	 */
 	virtual void ClearBadWords() = 0;
 
+	/** Find the first badword, in list order, that matches a message
+	 * @param message The message
+	 * @param casesensitive Whether the badwords are case sensitive
+	 * @return The badword, or NULL if none match
+	 */
+	virtual BadWord* MatchBadWord(const Anope::string &message, bool casesensitive) = 0;
+
 	virtual void Check() = 0;
 };
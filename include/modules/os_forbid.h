@@ -21,6 +21,8 @@ enum ForbidType
 struct ForbidData
 {
 	Anope::string mask;
+	/* mask compiled for matching, updated by the forbid service when the forbid is added or changed */
+	Anope::Glob glob;
 	Anope::string creator;
 	Anope::string reason;
 	time_t created;
@@ -12,6 +12,8 @@
 struct IgnoreData
 {
 	Anope::string mask;
+	/* mask compiled for matching, updated by the ignore service when the ignore is added or loaded */
+	Anope::Glob glob;
 	Anope::string creator;
 	Anope::string reason;
 	time_t time; /* When do we stop ignoring them? */
@@ -79,6 +79,7 @@ Serializable* Exception::Unserialize(Serializable *obj, Serialize::Data &data)
 		ex = anope_dynamic_static_cast<Exception *>(obj);
 	else
 		ex = new Exception;
+
 	data["mask"] >> ex->mask;
 	data["limit"] >> ex->limit;
 	data["who"] >> ex->who;
@@ -86,8 +87,8 @@ Serializable* Exception::Unserialize(Serializable *obj, Serialize::Data &data)
 	data["time"] >> ex->time;
 	data["expires"] >> ex->expires;
 
-	if (!obj)
-		session_service->AddException(ex);
+	/* Exceptions which were already added are indexed again in place, as their mask may have changed */
+	session_service->AddException(ex);
 	return ex;
 }
 
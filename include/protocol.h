@@ -284,12 +284,14 @@ class CoreExport IRCDMessage : public Service
 	bool HasFlag(IRCDMessageFlag f) const { return flags.count(f); }
 };
 
-/** MessageTokenizer allows tokens in the IRC wire format to be read from a string */
+/** MessageTokenizer allows tokens in the IRC wire format to be read from a string.
+ * The string is not copied, so it must outlive the tokenizer.
+ */
 class CoreExport MessageTokenizer
 {
 private:
 	/** The message we are parsing tokens from. */
-	Anope::string message;
+	const Anope::string &message;
 
 	/** The current position within the message. */
 	Anope::string::size_type position;
@@ -298,6 +300,20 @@ private:
 	/** Create a tokenstream and fill it with the provided data. */
 	MessageTokenizer(const Anope::string &msg);
 
+	/** Find the next \<middle> token in the message without copying it.
+	 * @param start Set to the position of the token within the message.
+	 * @param len Set to the length of the token.
+	 * @return True if a token was found; otherwise, false.
+	 */
+	bool GetMiddle(Anope::string::size_type &start, Anope::string::size_type &len);
+
+	/** Find the next \<trailing> token in the message without copying it.
+	 * @param start Set to the position of the token within the message.
+	 * @param len Set to the length of the token.
+	 * @return True if a token was found; otherwise, false.
+	 */
+	bool GetTrailing(Anope::string::size_type &start, Anope::string::size_type &len);
+
 	/** Retrieve the next \<middle> token in the message.
 	 * @param token The next token available, or an empty string if none remain.
 	 * @return True if a token was retrieved; otherwise, false.
@@ -311,6 +327,48 @@ private:
 	bool GetTrailing(Anope::string &token);
 };
 
+/** Statistics about the messages received from the uplink for one command
+ */
+struct CoreExport MessageStats
+{
+	/* The number of latency histogram buckets. Bucket i counts the messages
+	 * which took less than 10^(i+1) microseconds to process, the last bucket
+	 * counts everything slower.
+	 */
+	static const unsigned Buckets = 7;
+
+	/* Number of messages received */
+	uint64_t count;
+	/* Total length of the messages received */
+	uint64_t bytes;
+	/* Total and longest time spent processing the messages, in microseconds */
+	uint64_t time, max;
+	uint64_t histogram[Buckets];
+
+	MessageStats() : count(0), bytes(0), time(0), max(0)
+	{
+		for (unsigned i = 0; i < Buckets; ++i)
+			histogram[i] = 0;
+	}
+
+	void Add(size_t len, uint64_t t)
+	{
+		++count;
+		bytes += len;
+		time += t;
+		if (t > max)
+			max = t;
+
+		unsigned bucket = 0;
+		for (uint64_t limit = 10; bucket + 1 < Buckets && t >= limit; limit *= 10)
+			++bucket;
+		++histogram[bucket];
+	}
+};
+
+/* Statistics for every command the protocol module knows about, by command name */
+extern CoreExport Anope::map<MessageStats> MessageStatsList;
+
 extern CoreExport IRCDProto *IRCD;
 
 #endif // PROTOCOL_H
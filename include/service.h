@@ -23,18 +23,23 @@
  */
 class CoreExport Service : public virtual Base
 {
-	static std::map<Anope::string, std::map<Anope::string, Service *> > Services;
-	static std::map<Anope::string, std::map<Anope::string, Anope::string> > Aliases;
+	typedef TR1NS::unordered_map<Anope::string, Service *, Anope::hash_cs> ServiceMap;
+	typedef TR1NS::unordered_map<Anope::string, Anope::string, Anope::hash_cs> AliasMap;
 
-	static Service *FindService(const std::map<Anope::string, Service *> &services, const std::map<Anope::string, Anope::string> *aliases, const Anope::string &n)
+	static TR1NS::unordered_map<Anope::string, ServiceMap, Anope::hash_cs> Services;
+	static TR1NS::unordered_map<Anope::string, AliasMap, Anope::hash_cs> Aliases;
+	/* Incremented every time a service or alias is added or removed */
+	static unsigned Generation;
+
+	static Service *FindService(const ServiceMap &services, const AliasMap *aliases, const Anope::string &n)
 	{
-		std::map<Anope::string, Service *>::const_iterator it = services.find(n);
+		ServiceMap::const_iterator it = services.find(n);
 		if (it != services.end())
 			return it->second;
 
 		if (aliases != NULL)
 		{
-			std::map<Anope::string, Anope::string>::const_iterator it2 = aliases->find(n);
+			AliasMap::const_iterator it2 = aliases->find(n);
 			if (it2 != aliases->end())
 				return FindService(services, aliases, it2->second);
 		}
@@ -42,14 +47,26 @@ class CoreExport Service : public virtual Base
 		return NULL;
 	}
 
+	template<typename M> static std::vector<Anope::string> GetKeys(const M &map, const Anope::string &t)
+	{
+		std::vector<Anope::string> keys;
+		typename M::const_iterator it = map.find(t);
+		if (it != map.end())
+			for (typename M::mapped_type::const_iterator it2 = it->second.begin(); it2 != it->second.end(); ++it2)
+				keys.push_back(it2->first);
+		/* The maps are unordered, but callers may show these to users */
+		std::sort(keys.begin(), keys.end());
+		return keys;
+	}
+
  public:
 	static Service *FindService(const Anope::string &t, const Anope::string &n)
 	{
-		std::map<Anope::string, std::map<Anope::string, Service *> >::const_iterator it = Services.find(t);
+		TR1NS::unordered_map<Anope::string, ServiceMap, Anope::hash_cs>::const_iterator it = Services.find(t);
 		if (it == Services.end())
 			return NULL;
 
-		std::map<Anope::string, std::map<Anope::string, Anope::string> >::const_iterator it2 = Aliases.find(t);
+		TR1NS::unordered_map<Anope::string, AliasMap, Anope::hash_cs>::const_iterator it2 = Aliases.find(t);
 		if (it2 != Aliases.end())
 			return FindService(it->second, &it2->second, n);
 
@@ -58,26 +75,37 @@ class CoreExport Service : public virtual Base
 
 	static std::vector<Anope::string> GetServiceKeys(const Anope::string &t)
 	{
-		std::vector<Anope::string> keys;
-		std::map<Anope::string, std::map<Anope::string, Service *> >::iterator it = Services.find(t);
-		if (it != Services.end())
-			for (std::map<Anope::string, Service *>::iterator it2 = it->second.begin(); it2 != it->second.end(); ++it2)
-				keys.push_back(it2->first);
-		return keys;
+		return GetKeys(Services, t);
+	}
+
+	static std::vector<Anope::string> GetAliasKeys(const Anope::string &t)
+	{
+		return GetKeys(Aliases, t);
+	}
+
+	/** Get the generation of the service registry. This changes whenever
+	 * a service or alias is added or removed, so anything caching the
+	 * results of FindService can tell when it must look them up again.
+	 */
+	static unsigned GetGeneration()
+	{
+		return Generation;
 	}
 
 	static void AddAlias(const Anope::string &t, const Anope::string &n, const Anope::string &v)
 	{
-		std::map<Anope::string, Anope::string> &smap = Aliases[t];
+		AliasMap &smap = Aliases[t];
 		smap[n] = v;
+		++Generation;
 	}
 
 	static void DelAlias(const Anope::string &t, const Anope::string &n)
 	{
-		std::map<Anope::string, Anope::string> &smap = Aliases[t];
+		AliasMap &smap = Aliases[t];
 		smap.erase(n);
 		if (smap.empty())
 			Aliases.erase(t);
+		++Generation;
 	}
 
 	Module *owner;
@@ -98,36 +126,65 @@ class CoreExport Service : public virtual Base
 
 	void Register()
 	{
-		std::map<Anope::string, Service *> &smap = Services[this->type];
+		ServiceMap &smap = Services[this->type];
 		if (smap.find(this->name) != smap.end())
 			throw ModuleException("Service " + this->type + " with name " + this->name + " already exists");
 		smap[this->name] = this;
+		++Generation;
 	}
 
 	void Unregister()
 	{
-		std::map<Anope::string, Service *> &smap = Services[this->type];
+		ServiceMap &smap = Services[this->type];
 		smap.erase(this->name);
 		if (smap.empty())
 			Services.erase(this->type);
+		++Generation;
 	}
 };
 
-/** Like Reference, but used to refer to Services.
+/** Like Reference, but used to refer to Services. Rather than being
+ * invalidated by the service it refers to, it looks the service up
+ * again whenever the service registry has changed since it last did.
  */
 template<typename T>
 class ServiceReference : public Reference<T>
 {
 	Anope::string type;
 	Anope::string name;
+	/* The registry generation ref was looked up in */
+	unsigned generation;
 
  public:
-	ServiceReference() { }
+	ServiceReference() : generation(Service::GetGeneration() - 1) { }
 
-	ServiceReference(const Anope::string &t, const Anope::string &n) : type(t), name(n)
+	ServiceReference(const Anope::string &t, const Anope::string &n) : type(t), name(n), generation(Service::GetGeneration() - 1)
 	{
 	}
 
+	/* The service does not know about this reference, so the copy must not register with it either */
+	ServiceReference(const ServiceReference<T> &other) : Reference<T>(), type(other.type), name(other.name), generation(other.generation)
+	{
+		this->ref = other.ref;
+		this->invalid = other.invalid;
+	}
+
+	~ServiceReference()
+	{
+		/* Keep Reference from trying to remove itself from the service */
+		this->ref = NULL;
+	}
+
+	inline ServiceReference<T> &operator=(const ServiceReference<T> &other)
+	{
+		this->type = other.type;
+		this->name = other.name;
+		this->generation = other.generation;
+		this->ref = other.ref;
+		this->invalid = other.invalid;
+		return *this;
+	}
+
 	inline void operator=(const Anope::string &n)
 	{
 		this->name = n;
@@ -136,20 +193,15 @@ class ServiceReference : public Reference<T>
 
 	operator bool() anope_override
 	{
-		if (this->invalid)
+		if (this->invalid || this->generation != ::Service::GetGeneration())
 		{
 			this->invalid = false;
-			this->ref = NULL;
-		}
-		if (!this->ref)
-		{
+			this->generation = ::Service::GetGeneration();
 			/* This really could be dynamic_cast in every case, except for when a module
 			 * creates its own service type (that other modules must include the header file
 			 * for), as the core is not compiled with it so there is no RTTI for it.
 			 */
 			this->ref = static_cast<T *>(::Service::FindService(this->type, this->name));
-			if (this->ref)
-				this->ref->AddReference(this);
 		}
 		return this->ref;
 	}
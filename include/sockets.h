@@ -16,6 +16,7 @@
 #include <netinet/in.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #endif
 
 #include "anope.h"
@@ -115,6 +116,151 @@ class CoreExport cidr
 	};
 };
 
+/** A binary trie of CIDR ranges, used to find every range containing an
+ * address without checking each range in turn.
+ */
+template<typename T> class cidr_trie
+{
+	struct Node
+	{
+		Node *child[2];
+		std::vector<T> values;
+
+		Node() { child[0] = child[1] = NULL; }
+		~Node() { delete child[0]; delete child[1]; }
+	};
+
+	Node root4, root6;
+	size_t count;
+
+	cidr_trie(const cidr_trie &);
+	cidr_trie &operator=(const cidr_trie &);
+
+	/* The root and the address bits for an address, or NULL for an unsupported family */
+	const unsigned char *GetBits(const sockaddrs &addr, unsigned &bits, Node *&root) const
+	{
+		switch (addr.family())
+		{
+			case AF_INET:
+				bits = 32;
+				root = const_cast<Node *>(&root4);
+				return reinterpret_cast<const unsigned char *>(&addr.sa4.sin_addr);
+			case AF_INET6:
+				bits = 128;
+				root = const_cast<Node *>(&root6);
+				return reinterpret_cast<const unsigned char *>(&addr.sa6.sin6_addr);
+		}
+		return NULL;
+	}
+
+	static inline unsigned Bit(const unsigned char *b, unsigned i)
+	{
+		return (b[i / 8] >> (7 - i % 8)) & 1;
+	}
+
+ public:
+	cidr_trie() : count(0) { }
+
+	/** Add a value for a range
+	 * @param addr The address of the range
+	 * @param len The prefix length of the range, capped at the length of the address
+	 * @param value The value
+	 */
+	void insert(const sockaddrs &addr, unsigned len, const T &value)
+	{
+		unsigned bits;
+		Node *node;
+		const unsigned char *b = GetBits(addr, bits, node);
+		if (!b)
+			return;
+
+		for (unsigned i = 0; i < len && i < bits; ++i)
+		{
+			Node *&next = node->child[Bit(b, i)];
+			if (!next)
+				next = new Node();
+			node = next;
+		}
+
+		node->values.push_back(value);
+		++count;
+	}
+
+	/** Remove a value previously added with insert()
+	 * @return true if it was found
+	 */
+	bool erase(const sockaddrs &addr, unsigned len, const T &value)
+	{
+		unsigned bits;
+		Node *node;
+		const unsigned char *b = GetBits(addr, bits, node);
+		if (!b)
+			return false;
+
+		Node *path[129];
+		unsigned depth = 0;
+		for (; depth < len && depth < bits && node; ++depth)
+		{
+			path[depth] = node;
+			node = node->child[Bit(b, depth)];
+		}
+		if (!node)
+			return false;
+
+		typename std::vector<T>::iterator it = std::find(node->values.begin(), node->values.end(), value);
+		if (it == node->values.end())
+			return false;
+		*it = node->values.back();
+		node->values.pop_back();
+		--count;
+
+		/* Prune the nodes which are now unused */
+		while (depth > 0 && node->values.empty() && !node->child[0] && !node->child[1])
+		{
+			Node *parent = path[--depth];
+			parent->child[Bit(b, depth)] = NULL;
+			delete node;
+			node = parent;
+		}
+		return true;
+	}
+
+	/** Find the values of every range containing an address
+	 * @param addr The address
+	 * @param values The values are appended here
+	 */
+	void find(const sockaddrs &addr, std::vector<T> &values) const
+	{
+		unsigned bits;
+		Node *node;
+		const unsigned char *b = GetBits(addr, bits, node);
+		if (!b)
+			return;
+
+		for (unsigned i = 0; node; ++i)
+		{
+			values.insert(values.end(), node->values.begin(), node->values.end());
+			node = i < bits ? node->child[Bit(b, i)] : NULL;
+		}
+	}
+
+	void clear()
+	{
+		for (int i = 0; i < 2; ++i)
+		{
+			delete root4.child[i];
+			delete root6.child[i];
+			root4.child[i] = root6.child[i] = NULL;
+		}
+		root4.values.clear();
+		root6.values.clear();
+		count = 0;
+	}
+
+	inline size_t size() const { return count; }
+	inline bool empty() const { return count == 0; }
+};
+
 class SocketException : public CoreException
 {
  public:
@@ -162,6 +308,15 @@ class CoreExport SocketIO
 	virtual int Send(Socket *s, const char *buf, size_t sz);
 	int Send(Socket *s, const Anope::string &buf);
 
+	/** Write multiple blocks of data to the socket at once
+	 * @param s The socket
+	 * @param iov The blocks of data
+	 * @param iovcnt The number of blocks
+	 * @return Number of bytes written
+	 */
+	virtual int Writev(Socket *s, const iovec *iov, int iovcnt);
+	int Writev(Socket *s, const SocketBuffer &buf);
+
 	/** Accept a connection from a socket
 	 * @param s The socket
 	 * @return The new socket
@@ -201,6 +356,19 @@ class CoreExport SocketIO
 
 class CoreExport Socket
 {
+ public:
+	/** What a read found out about whether there is more to read
+	 */
+	enum ReadState
+	{
+		/* The socket can't tell */
+		RS_UNKNOWN,
+		/* There may be more to read */
+		RS_MORE,
+		/* Everything the socket had was read */
+		RS_DRAINED
+	};
+
  protected:
 	/* Socket FD */
 	int sock;
@@ -210,6 +378,9 @@ class CoreExport Socket
  public:
 	std::bitset<SF_SIZE> flags;
 
+	/* Set by ProcessRead(), edge triggered socket engines read until this is RS_DRAINED */
+	ReadState read_state;
+
 	/* Sockaddrs for bind() (if it's bound) */
 	sockaddrs bindaddr;
 
@@ -274,13 +445,105 @@ class CoreExport Socket
 	virtual void ProcessError();
 };
 
+/** A first in first out byte buffer used by sockets. Data is stored in a list of
+ * fixed size chunks so appending to the back and consuming from the front never
+ * has to move the data that remains in the buffer.
+ */
+class CoreExport SocketBuffer
+{
+ public:
+	/* The size of one chunk of data */
+	static const size_t ChunkSize = 16384;
+
+ private:
+	struct Chunk
+	{
+		char data[ChunkSize];
+		/* Offsets of the first used byte and one past the last used byte */
+		size_t start, end;
+	};
+
+	std::deque<Chunk *> chunks;
+	/* An emptied chunk kept for reuse */
+	Chunk *spare;
+	/* Total number of bytes in the buffer */
+	size_t len;
+
+	SocketBuffer(const SocketBuffer &);
+	SocketBuffer &operator=(const SocketBuffer &);
+
+	Chunk *NewChunk();
+	void FreeChunk(Chunk *c);
+
+ public:
+	SocketBuffer();
+	~SocketBuffer();
+
+	/** Append data to the end of the buffer
+	 * @param data The data
+	 * @param l The length of the data
+	 */
+	void Append(const char *data, size_t l);
+	void Append(const Anope::string &data);
+
+	/** Find a character in the buffer
+	 * @param c The character to search for
+	 * @param pos The offset to start searching at
+	 * @return The offset of the character, or Anope::string::npos if it was not found
+	 */
+	size_t Find(char c, size_t pos = 0) const;
+
+	/** Remove data from the front of the buffer
+	 * @param l How much data to remove
+	 */
+	void Consume(size_t l);
+
+	/** Remove data from the front of the buffer and store it in a string
+	 * @param out The string to store the data in
+	 * @param l How much data to remove
+	 */
+	void Extract(Anope::string &out, size_t l);
+
+	/** Remove any of the given characters from the front of the buffer
+	 * @param chars The characters to remove
+	 */
+	void LTrim(const char *chars);
+
+	/** Get the first contiguous block of data in the buffer
+	 * @param l Set to the length of the block
+	 * @return The block, or NULL if the buffer is empty
+	 */
+	const char *Front(size_t &l) const;
+
+	/** Get the blocks of data in the buffer, for use with vectored I/O
+	 * @param iov The array to store the blocks in
+	 * @param max The size of iov
+	 * @return The number of blocks stored in iov
+	 */
+	int GetBlocks(iovec *iov, int max) const;
+
+	/** Get the amount of data in the buffer
+	 */
+	size_t Length() const;
+
+	/** Check if the buffer is empty
+	 */
+	bool Empty() const;
+
+	/** Remove all data from the buffer
+	 */
+	void Clear();
+};
+
 class CoreExport BufferedSocket : public virtual Socket
 {
  protected:
 	/* Things read from the socket */
-	Anope::string read_buffer;
+	SocketBuffer read_buffer;
+	/* How much of read_buffer has already been searched for a newline */
+	size_t read_scanned;
 	/* Things to be written to the socket */
-	Anope::string write_buffer;
+	SocketBuffer write_buffer;
 	/* How much data was received from this socket on this recv() */
 	int recv_len;
 
@@ -325,18 +588,8 @@ class CoreExport BufferedSocket : public virtual Socket
 class CoreExport BinarySocket : public virtual Socket
 {
  protected:
-	struct DataBlock
-	{
-		char *orig;
-		char *buf;
-		size_t len;
-
-		DataBlock(const char *b, size_t l);
-		~DataBlock();
-	};
-
 	/* Data to be written out */
-	std::deque<DataBlock *> write_buffer;
+	SocketBuffer write_buffer;
 
  public:
 	BinarySocket();
@@ -115,6 +115,11 @@ class CoreExport Condition : public Mutex
 	/** Called to wait for a Wakeup() call
 	 */
 	void Wait();
+
+	/** Called to wait for a Wakeup() call, or until the given time has passed
+	 * @param ms The most milliseconds to wait for
+	 */
+	void Wait(long ms);
 };
 
 #endif // THREADENGINE_H
@@ -16,6 +16,8 @@
 
 class CoreExport Timer
 {
+	friend class TimerManager;
+
  private:
 	/** The owner of the timer, if any
 	 */
@@ -37,6 +39,11 @@ class CoreExport Timer
 	 */
 	bool repeat;
 
+	/** The TimerManager list this timer is in, if any, and its position in it
+	 */
+	std::list<Timer *> *list;
+	std::list<Timer *>::iterator pos;
+
  public:
 	/** Constructor, initializes the triggering time
 	 * @param time_from_now The number of seconds from now to trigger the timer
@@ -101,12 +108,22 @@ class CoreExport Timer
 /** This class manages sets of Timers, and triggers them at their defined times.
  * This will ensure timers are not missed, as well as removing timers that have
  * expired and allowing the addition of new ones.
+ *
+ * Timers are kept in a timing wheel with one slot per second, so adding,
+ * deleting and triggering a timer does not depend on how many timers exist.
+ * Timers due further in the future than the wheel covers wait in an overflow
+ * list which is moved into the wheel once per revolution.
  */
 class CoreExport TimerManager
 {
-	/** A list of timers
+	/** Move timers from the overflow list into the wheel once they are close enough to be due
 	 */
-	static std::multimap<time_t, Timer *> Timers;
+	static void Cascade();
+
+	/** Re-add every timer, used when the time has jumped further than the wheel covers
+	 * @param ctime The current time
+	 */
+	static void Rebuild(time_t ctime);
  public:
 	/** Add a timer to the list
 	 * @param t A Timer derived class to add
@@ -126,6 +143,12 @@ class CoreExport TimerManager
 	/** Deletes all timers owned by the given module
 	 */
 	static void DeleteTimersFor(Module *m);
+
+	/** Get how long to wait for events before timers need to be ticked again
+	 * @param max The longest time to wait, in milliseconds
+	 * @return The time to wait, in milliseconds
+	 */
+	static long GetWaitTime(long max);
 };
 
 #endif // TIMERS_H
@@ -31,6 +31,18 @@ class UplinkSocket : public ConnectionSocket, public BufferedSocket
 	void OnConnect() anope_override;
 	void OnError(const Anope::string &) anope_override;
 
+	/** Write out everything queued for the uplink. Lines sent to the uplink are
+	 * queued until this is called at the end of the main loop iteration, or until
+	 * options:uplinkflushsize bytes are queued.
+	 */
+	void Flush();
+
+ protected:
+	void Write(const char *buffer, size_t l) anope_override;
+
+ public:
+	using BufferedSocket::Write;
+
 	/* A message sent over the uplink socket */
 	class CoreExport Message
 	{
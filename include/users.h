@@ -39,8 +39,8 @@ class CoreExport User : public virtual Base, public Extensible, public CommandRe
  public:
 	typedef std::map<Anope::string, Anope::string> ModeList;
  protected:
-	Anope::string vident;
-	Anope::string ident;
+	Anope::InternedString vident;
+	Anope::InternedString ident;
 	Anope::string uid;
 	/* If the user is on the access list of the nick they're on */
 	bool on_access;
@@ -60,13 +60,13 @@ class CoreExport User : public virtual Base, public Extensible, public CommandRe
 	Anope::string nick;
 
 	/* User's real hostname */
-	Anope::string host;
+	Anope::InternedString host;
 	/* User's virtual hostname */
-	Anope::string vhost;
+	Anope::InternedString vhost;
 	/* User's cloaked hostname */
-	Anope::string chost;
+	Anope::InternedString chost;
 	/* Realname */
-	Anope::string realname;
+	Anope::InternedString realname;
 	/* SSL Fingerprint */
 	Anope::string fingerprint;
 	/* User's IP */
@@ -81,7 +81,7 @@ class CoreExport User : public virtual Base, public Extensible, public CommandRe
 	bool super_admin;
 
 	/* Channels the user is in */
-	typedef std::map<Channel *, ChanUserContainer *> ChanUserList;
+	typedef ChanUserContainerList<1> ChanUserList;
 	ChanUserList chans;
 
 	/* Last time this user sent a memo command used */
@@ -313,9 +313,7 @@ class CoreExport User : public virtual Base, public Extensible, public CommandRe
 
 	const ModeList &GetModeList() const;
 
-	/** Find the channel container for Channel c that the user is on
-	 * This is preferred over using FindUser in Channel, as there are usually more users in a channel
-	 * than channels a user is in
+	/** Find the channel container for Channel c that the user is on, the same as Channel::FindUser
 	 * @param c The channel
 	 * @return The channel container, or NULL
 	 */
@@ -0,0 +1,65 @@
+/*
+ *
+ * (C) 2003-2020 Anope Team
+ * Contact us at team@anope.org
+ *
+ * Please read COPYING and README for further details.
+ *
+ * Based on the original code of Epona by Lara.
+ * Based on the original code of Services by Andy Church.
+ */
+
+#ifndef WATCHDOG_H
+#define WATCHDOG_H
+
+#include "services.h"
+#include "anope.h"
+
+/** Watches the main loop from another thread. If the main loop is busy for
+ * longer than options:stallthreshold, what it was doing at the time is
+ * logged once it is done.
+ */
+class CoreExport Watchdog
+{
+ public:
+	/** Something the main loop is doing, such as running a timer or processing
+	 * a message. These nest, and the ones which were active when a stall was
+	 * noticed are logged with it. They do nothing if the watchdog is disabled.
+	 */
+	class CoreExport Context
+	{
+		bool active;
+
+		void Push(const char *what, const char *detail);
+
+	 public:
+		/** Constructor
+		 * @param what What is being done, eg "timer"
+		 * @param detail What it is being done to, eg the owner of the timer
+		 */
+		Context(const char *what, const Anope::string &detail);
+
+		/** Constructor
+		 * @param what What is being done, eg "socket"
+		 * @param num A number identifying what it is being done to, eg the fd of the socket
+		 */
+		Context(const char *what, int num);
+
+		~Context();
+	};
+
+	/** Called when the main loop starts doing something, after it has waited for events
+	 */
+	static void Begin();
+
+	/** Called when the main loop is done with what it was doing and is about to wait for events.
+	 * If a stall was noticed since Begin() was called, it is logged.
+	 */
+	static void End();
+
+	/** Stops the watchdog thread
+	 */
+	static void Shutdown();
+};
+
+#endif // WATCHDOG_H
@@ -18,6 +18,8 @@ class CoreExport XLine : public Serializable
 {
 	void Init();
 	Anope::string nick, user, host, real;
+	/* The mask and each part of it compiled for matching against */
+	Anope::Glob mask_glob, nick_glob, user_glob, host_glob, real_glob;
  public:
 	cidr *c;
 	Anope::string mask;
@@ -39,6 +41,12 @@ class CoreExport XLine : public Serializable
 	const Anope::string &GetHost() const;
 	const Anope::string &GetReal() const;
 
+	inline const Anope::Glob &GetMaskGlob() const { return mask_glob; }
+	inline const Anope::Glob &GetNickGlob() const { return nick_glob; }
+	inline const Anope::Glob &GetUserGlob() const { return user_glob; }
+	inline const Anope::Glob &GetHostGlob() const { return host_glob; }
+	inline const Anope::Glob &GetRealGlob() const { return real_glob; }
+
 	Anope::string GetReason() const;
 
 	bool HasNickOrReal() const;
@@ -48,6 +56,85 @@ class CoreExport XLine : public Serializable
 	static Serializable* Unserialize(Serializable *obj, Serialize::Data &data);
 };
 
+/* Indexes the xlines of an XLineManager by the masks given by XLineManager::GetIndexMask, so
+ * users only need to be checked against the xlines they could possibly match. Literal masks
+ * are kept in a hash, masks with only a leading or trailing * in tries of their literal part,
+ * and CIDR ranges in a cidr_trie. Everything else is checked against every user.
+ */
+class CoreExport XLineIndex
+{
+ public:
+	struct Item
+	{
+		XLine *x;
+		/* The order the xline was added to the index in, newer xlines have larger numbers */
+		unsigned long seq;
+
+		inline bool operator==(const Item &other) const { return x == other.x; }
+	};
+
+ private:
+	struct Node;
+
+	enum Kind
+	{
+		RESIDUAL,
+		EXACT,
+		PREFIX,
+		SUFFIX
+	};
+
+	/* Where an xline was placed, so it can be removed even if it has changed since */
+	struct Placement
+	{
+		unsigned long seq;
+		Kind kind;
+		Anope::string key;
+		bool range;
+		sockaddrs key_addr;
+		unsigned key_len;
+	};
+
+	unsigned long next_seq;
+	TR1NS::unordered_map<XLine *, Placement> placements;
+	TR1NS::unordered_map<Anope::string, std::vector<Item>, Anope::hash_cs> exact;
+	Node *prefixes, *suffixes;
+	cidr_trie<Item> ranges;
+	/* Xlines which can not be indexed, oldest first */
+	std::vector<Item> residual;
+
+	XLineIndex(const XLineIndex &);
+	XLineIndex &operator=(const XLineIndex &);
+
+	void Insert(Node *root, const Anope::string &key, bool reverse, const Item &item);
+	void Erase(Node *root, const Anope::string &key, bool reverse, XLine *x);
+	void Walk(const Node *root, const Anope::string &key, bool reverse, std::vector<Item> &items) const;
+
+ public:
+	XLineIndex();
+	~XLineIndex();
+
+	/** Add an xline
+	 * @param x The xline
+	 * @param mask The mask to index it by, or empty if it can not be indexed
+	 */
+	void Add(XLine *x, const Anope::string &mask);
+
+	/** Remove an xline
+	 * @param x The xline
+	 */
+	void Del(XLine *x);
+
+	void Clear();
+
+	/** Find the xlines which could match something
+	 * @param keys The strings to find the xlines whose masks match them
+	 * @param ip The IP address to find the xlines whose CIDR ranges contain it
+	 * @param items Every xline which could match, including those which can not be indexed, newest first
+	 */
+	void Find(const std::vector<Anope::string> &keys, const sockaddrs &ip, std::vector<Item> &items) const;
+};
+
 /* Managers XLines. There is one XLineManager per type of XLine. */
 class CoreExport XLineManager : public Service
 {
@@ -56,6 +143,12 @@ class CoreExport XLineManager : public Service
 	Serialize::Checker<std::vector<XLine *> > xlines;
 	/* Akills can have the same IDs, sometimes */
 	static Serialize::Checker<std::multimap<Anope::string, XLine *, ci::less> > XLinesByUID;
+	/* The xlines in this XLineManager, indexed for CheckAllXLines */
+	XLineIndex xline_index;
+	/* The xlines in this XLineManager by mask, oldest first */
+	Anope::hash_map<std::vector<XLine *> > xlines_by_mask;
+	/* The xlines in this XLineManager which expire, by when they expire */
+	std::set<std::pair<time_t, XLine *> > expiry;
  public:
 	/* List of XLine managers we check users against in XLineManager::CheckAll */
 	static std::list<XLineManager *> XLineManagers;
@@ -97,6 +190,18 @@ class CoreExport XLineManager : public Service
 	 */
 	const char &Type();
 
+	/** Add an xline of this manager to its indexes, by its mask, expiry and ID.
+	 * This is done by AddXLine, and only needs to be called again after Unindex.
+	 * @param x The xline
+	 */
+	void Index(XLine *x);
+
+	/** Remove an xline from the indexes of this manager. This must be done before
+	 * its mask, expiry or ID are changed, after which it is indexed again with Index.
+	 * @param x The xline
+	 */
+	void Unindex(XLine *x);
+
 	/** Get the number of XLines in this XLineManager
 	 * @return The number of XLines
 	 */
@@ -146,6 +251,10 @@ class CoreExport XLineManager : public Service
 	 */
 	XLine* HasEntry(const Anope::string &mask);
 
+	/** Delete every xline in this XLineManager which has expired
+	 */
+	void Expire();
+
 	/** Check a user against all of the xlines in this XLineManager
 	 * @param u The user
 	 * @return The xline the user marches, if any.
@@ -158,6 +267,20 @@ class CoreExport XLineManager : public Service
 	 */
 	virtual bool Check(User *u, const XLine *x) = 0;
 
+	/** Get what an xline is indexed by. Check() must only be true for users who either have a
+	 * string from GetIndexKeys() matching the mask, or have an IP within the xline's CIDR range.
+	 * @param x The xline
+	 * @param mask Set to the mask
+	 * @return false if the xline can not be indexed, and must be checked against every user
+	 */
+	virtual bool GetIndexMask(const XLine *x, Anope::string &mask);
+
+	/** Get the strings of a user to find the xlines indexed by masks matching them
+	 * @param u The user
+	 * @param keys The strings are appended here
+	 */
+	virtual void GetIndexKeys(User *u, std::vector<Anope::string> &keys);
+
 	/** Called when a user matches a xline in this XLineManager
 	 * @param u The user
 	 * @param x The XLine they match
@@ -27,11 +27,206 @@ struct BadWordImpl : BadWord, Serializable
 	static Serializable* Unserialize(Serializable *obj, Serialize::Data &);
 };
 
+/* Matches a message against all of a channel's badwords at once using an
+ * Aho-Corasick automaton, which is built the first time it is needed after
+ * the badword list changes.
+ */
+class BadWordMatcher
+{
+	struct Node
+	{
+		/* Sorted by character */
+		std::vector<std::pair<unsigned char, unsigned> > children;
+		unsigned fail;
+		/* The nearest node along the fail links that ends a word, 0 if there is none */
+		unsigned output;
+		unsigned depth;
+		/* Indexes of the words ending at this node, in list order */
+		std::vector<unsigned> words;
+
+		Node() : fail(0), output(0), depth(0) { }
+	};
+
+	std::vector<Node> nodes;
+	/* Transitions out of the root, which most characters of a message end up taking */
+	unsigned root[256];
+	std::vector<BadWordType> types;
+	/* Whether each word contains a space, which some SINGLE checks never match */
+	std::vector<bool> spaced;
+	bool built, casesensitive;
+
+	unsigned char Fold(char c) const
+	{
+		return this->casesensitive ? c : Anope::toupper(c);
+	}
+
+	/* Whether the last len characters of a message also occur earlier in it */
+	bool OccursEarlier(const Anope::string &text, unsigned len) const
+	{
+		unsigned tail = text.length() - len;
+		for (unsigned p = 0; p < tail; ++p)
+		{
+			unsigned k = 0;
+			while (k < len && this->Fold(text[p + k]) == this->Fold(text[tail + k]))
+				++k;
+			if (k == len)
+				return true;
+		}
+		return false;
+	}
+
+	/* Whether a SINGLE word matches where it was found. This is the same as the
+	 * word being surrounded by spaces or the ends of the message, except for
+	 * the quirks of how this was checked before: a word which is at only one
+	 * end of the message must not contain a space, and at the end of the
+	 * message it must also not have been found earlier in it.
+	 */
+	bool MatchSingle(const Anope::string &text, unsigned start, unsigned len, bool left, bool right, unsigned word) const
+	{
+		bool at_start = !start, at_end = start + len == text.length();
+		if (!left || !right)
+			return false;
+		if (at_start == at_end)
+			return true;
+		if (this->spaced[word])
+			return false;
+		return at_start || !this->OccursEarlier(text, len);
+	}
+
+	unsigned Child(unsigned n, unsigned char c) const
+	{
+		const std::vector<std::pair<unsigned char, unsigned> > &children = this->nodes[n].children;
+		std::vector<std::pair<unsigned char, unsigned> >::const_iterator it = std::lower_bound(children.begin(), children.end(), std::make_pair(c, 0U));
+		return it != children.end() && it->first == c ? it->second : 0;
+	}
+
+ public:
+	BadWordMatcher() : built(false), casesensitive(false) { }
+
+	void Invalidate()
+	{
+		this->built = false;
+		this->nodes.clear();
+		this->types.clear();
+		this->spaced.clear();
+	}
+
+	bool IsBuilt(bool cs) const
+	{
+		return this->built && this->casesensitive == cs;
+	}
+
+	void Build(const std::vector<BadWordImpl *> &words, bool cs)
+	{
+		this->casesensitive = cs;
+		this->nodes.assign(1, Node());
+		this->types.clear();
+		this->spaced.clear();
+
+		for (unsigned i = 0; i < words.size(); ++i)
+		{
+			const Anope::string &word = words[i]->word;
+			this->types.push_back(words[i]->type);
+			this->spaced.push_back(word.find(' ') != Anope::string::npos);
+
+			unsigned n = 0;
+			for (unsigned j = 0; j < word.length(); ++j)
+			{
+				unsigned char c = this->Fold(word[j]);
+				unsigned next = this->Child(n, c);
+				if (!next)
+				{
+					next = this->nodes.size();
+					this->nodes.push_back(Node());
+					this->nodes[next].depth = this->nodes[n].depth + 1;
+					std::vector<std::pair<unsigned char, unsigned> > &children = this->nodes[n].children;
+					children.insert(std::lower_bound(children.begin(), children.end(), std::make_pair(c, 0U)), std::make_pair(c, next));
+				}
+				n = next;
+			}
+
+			/* Empty words never match */
+			if (n)
+				this->nodes[n].words.push_back(i);
+		}
+
+		/* Fail links are set breadth first, so those of shallower nodes are always already known */
+		std::vector<unsigned> queue(1, 0);
+		for (unsigned q = 0; q < queue.size(); ++q)
+		{
+			unsigned n = queue[q];
+			for (unsigned i = 0; i < this->nodes[n].children.size(); ++i)
+			{
+				unsigned char c = this->nodes[n].children[i].first;
+				unsigned child = this->nodes[n].children[i].second, f = 0;
+
+				if (n)
+				{
+					f = this->nodes[n].fail;
+					while (f && !this->Child(f, c))
+						f = this->nodes[f].fail;
+					f = this->Child(f, c);
+				}
+
+				Node &node = this->nodes[child];
+				node.fail = f;
+				node.output = this->nodes[f].words.empty() ? this->nodes[f].output : f;
+				queue.push_back(child);
+			}
+		}
+
+		for (unsigned c = 0; c < 256; ++c)
+			this->root[c] = this->Child(0, c);
+
+		this->built = true;
+	}
+
+	/** Find the first badword in list order that matches a message
+	 * @param text The message
+	 * @return The index of the badword, or -1 if none match
+	 */
+	int Match(const Anope::string &text) const
+	{
+		int best = -1;
+		unsigned n = 0;
+
+		for (unsigned i = 0; i < text.length() && best != 0; ++i)
+		{
+			unsigned char c = this->Fold(text[i]);
+			unsigned next = 0;
+			while (n && !(next = this->Child(n, c)))
+				n = this->nodes[n].fail;
+			n = n ? next : this->root[c];
+
+			bool right = i + 1 == text.length() || text[i + 1] == ' ';
+			for (unsigned m = this->nodes[n].words.empty() ? this->nodes[n].output : n; m; m = this->nodes[m].output)
+			{
+				unsigned len = this->nodes[m].depth, start = i + 1 - len;
+				bool left = !start || text[start - 1] == ' ';
+
+				const std::vector<unsigned> &ws = this->nodes[m].words;
+				for (unsigned j = 0; j < ws.size() && (best < 0 || ws[j] < static_cast<unsigned>(best)); ++j)
+				{
+					BadWordType type = this->types[ws[j]];
+					if (type == BW_ANY || (type == BW_SINGLE && this->MatchSingle(text, start, len, left, right, ws[j])) || (type == BW_START && left) || (type == BW_END && right))
+					{
+						best = ws[j];
+						break;
+					}
+				}
+			}
+		}
+
+		return best;
+	}
+};
+
 struct BadWordsImpl : BadWords
 {
 	Serialize::Reference<ChannelInfo> ci;
 	typedef std::vector<BadWordImpl *> list;
 	Serialize::Checker<list> badwords;
+	BadWordMatcher matcher;
 
 	BadWordsImpl(Extensible *obj) : ci(anope_dynamic_static_cast<ChannelInfo *>(obj)), badwords("BadWord") { }
 
@@ -45,6 +240,7 @@ struct BadWordsImpl : BadWords
 		bw->type = type;
 
 		this->badwords->push_back(bw);
+		this->matcher.Invalidate();
 
 		FOREACH_MOD(OnBadWordAdd, (ci, bw));
 
@@ -82,6 +278,18 @@ struct BadWordsImpl : BadWords
 			delete this->badwords->back();
 	}
 
+	BadWord* MatchBadWord(const Anope::string &message, bool casesensitive) anope_override
+	{
+		if (this->badwords->empty())
+			return NULL;
+
+		if (!this->matcher.IsBuilt(casesensitive))
+			this->matcher.Build(*this->badwords, casesensitive);
+
+		int i = this->matcher.Match(message);
+		return i >= 0 ? (*this->badwords)[i] : NULL;
+	}
+
 	void Check() anope_override
 	{
 		if (this->badwords->empty())
@@ -109,7 +317,10 @@ BadWordImpl::~BadWordImpl()
 		{
 			BadWordsImpl::list::iterator it = std::find(badwords->badwords->begin(), badwords->badwords->end(), this);
 			if (it != badwords->badwords->end())
+			{
 				badwords->badwords->erase(it);
+				badwords->matcher.Invalidate();
+			}
 		}
 	}
 }
@@ -140,6 +351,7 @@ Serializable* BadWordImpl::Unserialize(Serializable *obj, Serialize::Data &data)
 	BadWordsImpl *bws = ci->Require<BadWordsImpl>("badwords");
 	if (!obj)
 		bws->badwords->push_back(bw);
+	bws->matcher.Invalidate();
 
 	return bw;
 }
@@ -371,7 +371,7 @@ class CommandCSAccess : public Command
 						for (Channel::ChanUserList::const_iterator cit = ci->c->users.begin(), cit_end = ci->c->users.end(); cit != cit_end; ++cit)
 						{
 							ChannelInfo *p;
-							if (access->Matches(cit->second->user, cit->second->user->Account(), p))
+							if (access->Matches((*cit)->user, (*cit)->user->Account(), p))
 								timebuf = "Now";
 						}
 					if (timebuf.empty())
@@ -408,7 +408,7 @@ class CommandCSAccess : public Command
 					for (Channel::ChanUserList::const_iterator cit = ci->c->users.begin(), cit_end = ci->c->users.end(); cit != cit_end; ++cit)
 					{
 						ChannelInfo *p;
-						if (access->Matches(cit->second->user, cit->second->user->Account(), p))
+						if (access->Matches((*cit)->user, (*cit)->user->Account(), p))
 							timebuf = "Now";
 					}
 				if (timebuf.empty())
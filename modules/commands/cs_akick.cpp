@@ -25,7 +25,7 @@ class CommandCSAKick : public Command
 
 		for (Channel::ChanUserList::iterator it = c->users.begin(), it_end = c->users.end(); it != it_end; )
 		{
-			ChanUserContainer *uc = it->second;
+			ChanUserContainer *uc = *it;
 			++it;
 
 			if (c->CheckKick(uc->user))
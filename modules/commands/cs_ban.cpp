@@ -179,7 +179,7 @@ class CommandCSBan : public Command
 			int matched = 0, kicked = 0;
 			for (Channel::ChanUserList::iterator it = c->users.begin(), it_end = c->users.end(); it != it_end;)
 			{
-				ChanUserContainer *uc = it->second;
+				ChanUserContainer *uc = *it;
 				++it;
 
 				Entry e(mode, mask);
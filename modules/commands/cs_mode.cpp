@@ -568,7 +568,7 @@ class CommandCSMode : public Command
 
 								for (Channel::ChanUserList::const_iterator it = ci->c->users.begin(), it_end = ci->c->users.end(); it != it_end;)
 								{
-									ChanUserContainer *uc = it->second;
+									ChanUserContainer *uc = *it;
 									++it;
 
 									AccessGroup targ_access = ci->AccessFor(uc->user);
@@ -224,7 +224,7 @@ class CommandSeen : public Command
 
 		for (Channel::ChanUserList::const_iterator it = source.c->users.begin(), it_end = source.c->users.end(); it != it_end; ++it)
 		{
-			ChanUserContainer *uc = it->second;
+			ChanUserContainer *uc = *it;
 			User *u = uc->user;
 
 			if (u->Account() == na->nc)
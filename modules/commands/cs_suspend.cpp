@@ -111,7 +111,7 @@ class CommandCSSuspend : public Command
 
 			for (Channel::ChanUserList::iterator it = ci->c->users.begin(), it_end = ci->c->users.end(); it != it_end; ++it)
 			{
-				ChanUserContainer *uc = it->second;
+				ChanUserContainer *uc = *it;
 				User *user = uc->user;
 				if (!user->HasMode("OPER") && user->server != Me)
 					users.push_back(user);
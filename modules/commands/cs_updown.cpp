@@ -57,7 +57,7 @@ class CommandCSUp : public Command
 				return;
 			for (User::ChanUserList::iterator it = source.GetUser()->chans.begin(); it != source.GetUser()->chans.end(); ++it)
 			{
-				Channel *c = it->second->chan;
+				Channel *c = (*it)->chan;
 				SetModes(source.GetUser(), c);
 			}
 			Log(LOG_COMMAND, source, this, NULL) << "on all channels to update their status modes";
@@ -155,7 +155,7 @@ class CommandCSDown : public Command
 				return;
 			for (User::ChanUserList::iterator it = source.GetUser()->chans.begin(); it != source.GetUser()->chans.end(); ++it)
 			{
-				Channel *c = it->second->chan;
+				Channel *c = (*it)->chan;
 				RemoveAll(source.GetUser(), c);
 			}
 			Log(LOG_COMMAND, source, this, NULL) << "on all channels to remove their status modes";
@@ -70,7 +70,7 @@ class NSRecoverRequest : public IdentifyRequest
 				{
 					NSRecoverInfo *ei = source.GetUser()->Extend<NSRecoverInfo>("recover");
 					for (User::ChanUserList::iterator it = u->chans.begin(), it_end = u->chans.end(); it != it_end; ++it)
-						(*ei)[it->first->name] = it->second->status;
+						(*ei)[(*it)->chan->name] = (*it)->status;
 				}
 			}
 
@@ -71,7 +71,7 @@ class CommandOSChanKill : public Command
 			{
 				for (Channel::ChanUserList::iterator it = c->users.begin(), it_end = c->users.end(); it != it_end; ++it)
 				{
-					ChanUserContainer *uc = it->second;
+					ChanUserContainer *uc = *it;
 
 					if (uc->user->server == Me || uc->user->HasMode("OPER"))
 						continue;
@@ -54,8 +54,8 @@ Serializable* ForbidDataImpl::Unserialize(Serializable *obj, Serialize::Data &da
 	if (t > FT_SIZE - 1)
 		return NULL;
 
-	if (!obj)
-		forbid_service->AddForbid(fb);
+	/* This also indexes the forbid again if it was already added */
+	forbid_service->AddForbid(fb);
 	return fb;
 }
 
@@ -63,10 +63,79 @@ class MyForbidService : public ForbidService
 {
 	Serialize::Checker<std::vector<ForbidData *>[FT_SIZE - 1]> forbid_data;
 
+	/* How a forbid is indexed, kept so it can be removed even after it has changed */
+	struct IndexedForbid
+	{
+		/* The order the forbid was added in, newer forbids are found first */
+		unsigned long seq;
+		ForbidType type;
+		Anope::string mask;
+	};
+
+	struct ForbidIndex
+	{
+		/* Forbids without wildcards, by mask */
+		Anope::hash_map<std::vector<ForbidData *> > literal;
+		/* Forbids with wildcards and regexes, oldest first */
+		std::vector<std::pair<unsigned long, ForbidData *> > wild;
+	};
+
+	unsigned long next_seq;
+	TR1NS::unordered_map<ForbidData *, IndexedForbid> indexed;
+	ForbidIndex index[FT_SIZE - 1];
+
 	inline std::vector<ForbidData *>& forbids(unsigned t) { return (*this->forbid_data)[t - 1]; }
 
+	static inline bool IsLiteral(const ForbidData *d)
+	{
+		return d->glob.IsLiteral() && d->mask[0] != '/';
+	}
+
+	void Index(ForbidData *d, unsigned long seq)
+	{
+		IndexedForbid &f = this->indexed[d];
+		f.seq = seq;
+		f.type = d->type;
+		f.mask = d->mask;
+
+		ForbidIndex &fi = this->index[d->type - 1];
+		if (IsLiteral(d))
+			fi.literal[d->mask].push_back(d);
+		else
+		{
+			std::pair<unsigned long, ForbidData *> entry(seq, d);
+			fi.wild.insert(std::lower_bound(fi.wild.begin(), fi.wild.end(), entry), entry);
+		}
+	}
+
+	void Unindex(ForbidData *d)
+	{
+		TR1NS::unordered_map<ForbidData *, IndexedForbid>::iterator it = this->indexed.find(d);
+		if (it == this->indexed.end())
+			return;
+		const IndexedForbid &f = it->second;
+		ForbidIndex &fi = this->index[f.type - 1];
+
+		Anope::hash_map<std::vector<ForbidData *> >::iterator lit = fi.literal.find(f.mask);
+		if (lit != fi.literal.end())
+		{
+			std::vector<ForbidData *>::iterator it2 = std::find(lit->second.begin(), lit->second.end(), d);
+			if (it2 != lit->second.end())
+				lit->second.erase(it2);
+			if (lit->second.empty())
+				fi.literal.erase(lit);
+		}
+
+		std::pair<unsigned long, ForbidData *> entry(f.seq, d);
+		std::vector<std::pair<unsigned long, ForbidData *> >::iterator wit = std::lower_bound(fi.wild.begin(), fi.wild.end(), entry);
+		if (wit != fi.wild.end() && wit->second == d)
+			fi.wild.erase(wit);
+
+		this->indexed.erase(it);
+	}
+
  public:
-	MyForbidService(Module *m) : ForbidService(m), forbid_data("ForbidData") { }
+	MyForbidService(Module *m) : ForbidService(m), forbid_data("ForbidData"), next_seq(0) { }
 
 	~MyForbidService()
 	{
@@ -77,7 +146,27 @@ class MyForbidService : public ForbidService
 
 	void AddForbid(ForbidData *d) anope_override
 	{
+		d->glob.Compile(d->mask);
+
+		TR1NS::unordered_map<ForbidData *, IndexedForbid>::iterator it = this->indexed.find(d);
+		if (it != this->indexed.end())
+		{
+			/* This forbid was already added and has been changed since, so only index it again */
+			IndexedForbid old = it->second;
+			this->Unindex(d);
+			if (old.type == d->type)
+			{
+				this->Index(d, old.seq);
+				return;
+			}
+
+			std::vector<ForbidData *>::iterator it2 = std::find(this->forbids(old.type).begin(), this->forbids(old.type).end(), d);
+			if (it2 != this->forbids(old.type).end())
+				this->forbids(old.type).erase(it2);
+		}
+
 		this->forbids(d->type).push_back(d);
+		this->Index(d, this->next_seq++);
 	}
 
 	void RemoveForbid(ForbidData *d) anope_override
@@ -85,6 +174,7 @@ class MyForbidService : public ForbidService
 		std::vector<ForbidData *>::iterator it = std::find(this->forbids(d->type).begin(), this->forbids(d->type).end(), d);
 		if (it != this->forbids(d->type).end())
 			this->forbids(d->type).erase(it);
+		this->Unindex(d);
 		delete d;
 	}
 
@@ -95,26 +185,72 @@ class MyForbidService : public ForbidService
 
 	ForbidData *FindForbid(const Anope::string &mask, ForbidType ftype) anope_override
 	{
-		for (unsigned i = this->forbids(ftype).size(); i > 0; --i)
+		if (this->forbids(ftype).empty())
+			return NULL;
+
+		const ForbidIndex &fi = this->index[ftype - 1];
+
+		ForbidData *best = NULL;
+		unsigned long best_seq = 0;
+		Anope::hash_map<std::vector<ForbidData *> >::const_iterator it = fi.literal.find(mask);
+		if (it != fi.literal.end())
+			for (unsigned i = 0; i < it->second.size(); ++i)
+			{
+				unsigned long seq = this->indexed[it->second[i]].seq;
+				if (!best || seq > best_seq)
+				{
+					best = it->second[i];
+					best_seq = seq;
+				}
+			}
+
+		for (unsigned i = fi.wild.size(); i > 0; --i)
 		{
-			ForbidData *d = this->forbids(ftype)[i - 1];
+			const std::pair<unsigned long, ForbidData *> &entry = fi.wild[i - 1];
+			if (best && entry.first < best_seq)
+				break;
 
-			if (Anope::Match(mask, d->mask, false, true))
+			ForbidData *d = entry.second;
+			if (d->glob.Matches(mask) || (d->mask[0] == '/' && Anope::Match(mask, d->mask, false, true)))
 				return d;
 		}
-		return NULL;
+
+		return best;
 	}
 
 	ForbidData *FindForbidExact(const Anope::string &mask, ForbidType ftype) anope_override
 	{
-		for (unsigned i = this->forbids(ftype).size(); i > 0; --i)
+		if (this->forbids(ftype).empty())
+			return NULL;
+
+		const ForbidIndex &fi = this->index[ftype - 1];
+
+		ForbidData *best = NULL;
+		unsigned long best_seq = 0;
+		Anope::hash_map<std::vector<ForbidData *> >::const_iterator it = fi.literal.find(mask);
+		if (it != fi.literal.end())
+			for (unsigned i = 0; i < it->second.size(); ++i)
+			{
+				unsigned long seq = this->indexed[it->second[i]].seq;
+				if (!best || seq > best_seq)
+				{
+					best = it->second[i];
+					best_seq = seq;
+				}
+			}
+
+		/* Masks with wildcards can only be equal to masks with the same wildcards */
+		for (unsigned i = fi.wild.size(); i > 0; --i)
 		{
-			ForbidData *d = this->forbids(ftype)[i - 1];
+			const std::pair<unsigned long, ForbidData *> &entry = fi.wild[i - 1];
+			if (best && entry.first < best_seq)
+				break;
 
-			if (d->mask.equals_ci(mask))
-				return d;
+			if (entry.second->mask.equals_ci(mask))
+				return entry.second;
 		}
-		return NULL;
+
+		return best;
 	}
 
 	std::vector<ForbidData *> GetForbids() anope_override
@@ -137,6 +273,7 @@ class MyForbidService : public ForbidService
 
 					Log(LOG_NORMAL, "expire/forbid", Config->GetClient("OperServ")) << "Expiring forbid for " << d->mask << " type " << ftype;
 					this->forbids(j).erase(this->forbids(j).begin() + i - 1);
+					this->Unindex(d);
 					delete d;
 				}
 				else
@@ -216,12 +353,8 @@ class CommandOSForbid : public Command
 			}
 
 			ForbidData *d = this->fs->FindForbidExact(entry, ftype);
-			bool created = false;
 			if (d == NULL)
-			{
 				d = new ForbidDataImpl();
-				created = true;
-			}
 
 			d->mask = entry;
 			d->creator = source.GetNick();
@@ -229,8 +362,8 @@ class CommandOSForbid : public Command
 			d->created = Anope::CurTime;
 			d->expires = expiryt;
 			d->type = ftype;
-			if (created)
-				this->fs->AddForbid(d);
+			/* This compiles the mask, and indexes the forbid again if it already existed */
+			this->fs->AddForbid(d);
 
 			if (Anope::ReadOnly)
 				source.Reply(READ_ONLY_MODE);
@@ -295,7 +428,7 @@ class CommandOSForbid : public Command
 
 						for (Channel::ChanUserList::const_iterator cit = c->users.begin(), cit_end = c->users.end(); cit != cit_end;)
 						{
-							User *u = cit->first;
+							User *u = (*cit)->user;
 							++cit;
 
 							if (u->server == Me || u->HasMode("OPER"))
@@ -43,16 +43,15 @@ Serializable* IgnoreDataImpl::Unserialize(Serializable *obj, Serialize::Data &da
 	if (obj)
 		ign = anope_dynamic_static_cast<IgnoreDataImpl *>(obj);
 	else
-	{
 		ign = new IgnoreDataImpl();
-		ignore_service->AddIgnore(ign);
-	}
 
 	data["mask"] >> ign->mask;
 	data["creator"] >> ign->creator;
 	data["reason"] >> ign->reason;
 	data["time"] >> ign->time;
 
+	/* This also indexes the ignore again if it was already added */
+	ignore_service->AddIgnore(ign);
 	return ign;
 }
 
@@ -61,12 +60,97 @@ class OSIgnoreService : public IgnoreService
 {
 	Serialize::Checker<std::vector<IgnoreData *> > ignores;
 
+	/* How an ignore is indexed, kept so it can be removed even after it has changed */
+	struct IndexedIgnore
+	{
+		/* The order the ignore was added in, older ignores are found first */
+		unsigned long seq;
+		Anope::string mask;
+		time_t time;
+	};
+
+	unsigned long next_seq;
+	TR1NS::unordered_map<IgnoreData *, IndexedIgnore> indexed;
+	/* The masks of every ignore, indexed for matching users against */
+	ListModeMatcher matcher;
+	/* Ignores by mask, oldest first */
+	Anope::hash_map<std::vector<IgnoreData *> > by_mask;
+	/* Ignores which expire, by when they expire */
+	std::set<std::pair<time_t, IgnoreData *> > expiry;
+
+	void Index(IgnoreData *ign, unsigned long seq)
+	{
+		IndexedIgnore &ii = this->indexed[ign];
+		ii.seq = seq;
+		ii.mask = ign->mask;
+		ii.time = ign->time;
+
+		std::vector<IgnoreData *> &same = this->by_mask[ign->mask];
+		if (same.empty())
+			this->matcher.Add(ign->mask);
+		same.push_back(ign);
+
+		if (ign->time)
+			this->expiry.insert(std::make_pair(ign->time, ign));
+	}
+
+	void Unindex(IgnoreData *ign)
+	{
+		TR1NS::unordered_map<IgnoreData *, IndexedIgnore>::iterator it = this->indexed.find(ign);
+		if (it == this->indexed.end())
+			return;
+		const IndexedIgnore &ii = it->second;
+
+		Anope::hash_map<std::vector<IgnoreData *> >::iterator mit = this->by_mask.find(ii.mask);
+		if (mit != this->by_mask.end())
+		{
+			std::vector<IgnoreData *>::iterator it2 = std::find(mit->second.begin(), mit->second.end(), ign);
+			if (it2 != mit->second.end())
+				mit->second.erase(it2);
+			if (mit->second.empty())
+			{
+				this->by_mask.erase(mit);
+				this->matcher.Del(ii.mask);
+			}
+		}
+
+		this->expiry.erase(std::make_pair(ii.time, ign));
+		this->indexed.erase(it);
+	}
+
+	void Expire()
+	{
+		if (Anope::NoExpire)
+			return;
+
+		while (!this->expiry.empty() && this->expiry.begin()->first <= Anope::CurTime)
+		{
+			IgnoreData *id = this->expiry.begin()->second;
+			this->expiry.erase(this->expiry.begin());
+			Log(LOG_NORMAL, "expire/ignore", Config->GetClient("OperServ")) << "Expiring ignore entry " << id->mask;
+			delete id;
+		}
+	}
+
  public:
-	OSIgnoreService(Module *o) : IgnoreService(o), ignores("IgnoreData") { }
+	OSIgnoreService(Module *o) : IgnoreService(o), ignores("IgnoreData"), next_seq(0), matcher("") { }
 
 	void AddIgnore(IgnoreData *ign) anope_override
 	{
+		ign->glob.Compile(ign->mask);
+
+		TR1NS::unordered_map<IgnoreData *, IndexedIgnore>::iterator it = this->indexed.find(ign);
+		if (it != this->indexed.end())
+		{
+			/* This ignore was already added and has been changed since, so only index it again */
+			unsigned long seq = it->second.seq;
+			this->Unindex(ign);
+			this->Index(ign, seq);
+			return;
+		}
+
 		ignores->push_back(ign);
+		this->Index(ign, this->next_seq++);
 	}
 
 	void DelIgnore(IgnoreData *ign) anope_override
@@ -74,6 +158,7 @@ class OSIgnoreService : public IgnoreService
 		std::vector<IgnoreData *>::iterator it = std::find(ignores->begin(), ignores->end(), ign);
 		if (it != ignores->end())
 			ignores->erase(it);
+		this->Unindex(ign);
 	}
 
 	void ClearIgnores() anope_override
@@ -92,58 +177,61 @@ class OSIgnoreService : public IgnoreService
 
 	IgnoreData *Find(const Anope::string &mask) anope_override
 	{
-		User *u = User::Find(mask, true);
-		std::vector<IgnoreData *>::iterator ign = this->ignores->begin(), ign_end = this->ignores->end();
+		if (this->ignores->empty())
+			return NULL;
 
+		this->Expire();
+
+		User *u = User::Find(mask, true);
 		if (u)
 		{
-			for (; ign != ign_end; ++ign)
-			{
-				Entry ignore_mask("", (*ign)->mask);
-				if (ignore_mask.Matches(u, true))
-					break;
-			}
-		}
-		else
-		{
-			size_t user, host;
-			Anope::string tmp;
-			/* We didn't get a user.. generate a valid mask. */
-			if ((host = mask.find('@')) != Anope::string::npos)
+			std::vector<Anope::string> masks;
+			this->matcher.GetMatches(u, true, masks);
+
+			/* The oldest ignore which matches is the one found */
+			IgnoreData *best = NULL;
+			unsigned long best_seq = 0;
+			for (unsigned i = 0; i < masks.size(); ++i)
 			{
-				if ((user = mask.find('!')) != Anope::string::npos)
+				Anope::hash_map<std::vector<IgnoreData *> >::const_iterator it = this->by_mask.find(masks[i]);
+				if (it == this->by_mask.end())
+					continue;
+
+				IgnoreData *id = it->second.front();
+				unsigned long seq = this->indexed[id].seq;
+				if (!best || seq < best_seq)
 				{
-					/* this should never happen */
-					if (user > host)
-						return NULL;
-					tmp = mask;
+					best = id;
+					best_seq = seq;
 				}
-				else
-					/* We have user@host. Add nick wildcard. */
-				tmp = "*!" + mask;
 			}
-			/* We only got a nick.. */
-			else
-				tmp = mask + "!*@*";
 
-			for (; ign != ign_end; ++ign)
-				if (Anope::Match(tmp, (*ign)->mask, false, true))
-					break;
+			return best;
 		}
 
-		/* Check whether the entry has timed out */
-		if (ign != ign_end)
+		size_t user, host;
+		Anope::string tmp;
+		/* We didn't get a user.. generate a valid mask. */
+		if ((host = mask.find('@')) != Anope::string::npos)
 		{
-			IgnoreData *id = *ign;
-
-			if (id->time && !Anope::NoExpire && id->time <= Anope::CurTime)
+			if ((user = mask.find('!')) != Anope::string::npos)
 			{
-				Log(LOG_NORMAL, "expire/ignore", Config->GetClient("OperServ")) << "Expiring ignore entry " << id->mask;
-				delete id;
+				/* this should never happen */
+				if (user > host)
+					return NULL;
+				tmp = mask;
 			}
 			else
-				return id;
+				/* We have user@host. Add nick wildcard. */
+			tmp = "*!" + mask;
 		}
+		/* We only got a nick.. */
+		else
+			tmp = mask + "!*@*";
+
+		for (std::vector<IgnoreData *>::iterator ign = this->ignores->begin(), ign_end = this->ignores->end(); ign != ign_end; ++ign)
+			if ((*ign)->glob.Matches(tmp) || ((*ign)->mask[0] == '/' && Anope::Match(tmp, (*ign)->mask, false, true)))
+				return *ign;
 
 		return NULL;
 	}
@@ -48,7 +48,7 @@ class CommandOSChanList : public Command
 
 			for (User::ChanUserList::iterator uit = u2->chans.begin(), uit_end = u2->chans.end(); uit != uit_end; ++uit)
 			{
-				ChanUserContainer *cc = uit->second;
+				ChanUserContainer *cc = *uit;
 
 				if (!modes.empty())
 					for (std::set<Anope::string>::iterator it = modes.begin(), it_end = modes.end(); it != it_end; ++it)
@@ -158,7 +158,7 @@ class CommandOSUserList : public Command
 
 			for (Channel::ChanUserList::iterator cuit = c->users.begin(), cuit_end = c->users.end(); cuit != cuit_end; ++cuit)
 			{
-				ChanUserContainer *uc = cuit->second;
+				ChanUserContainer *uc = *cuit;
 
 				if (!modes.empty())
 					for (std::set<Anope::string>::iterator it = modes.begin(), it_end = modes.end(); it != it_end; ++it)
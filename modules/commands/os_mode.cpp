@@ -49,7 +49,7 @@ class CommandOSMode : public Command
 			{
 				for (Channel::ChanUserList::iterator it = c->users.begin(), it_end = c->users.end(); it != it_end; ++it)
 				{
-					ChanUserContainer *uc = it->second;
+					ChanUserContainer *uc = *it;
 
 					if (uc->user->HasMode("OPER"))
 						continue;
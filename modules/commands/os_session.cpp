@@ -37,10 +37,138 @@ namespace
 
 class MySessionService : public SessionService
 {
+	/* How an exception is indexed, kept so it can be removed even if its mask changes */
+	struct IndexedException
+	{
+		/* The order the exception was added in, the first added exception which matches is used */
+		unsigned long seq;
+		Anope::string mask;
+		Anope::Glob glob;
+		bool range;
+		sockaddrs addr;
+		unsigned len;
+	};
+
 	SessionMap Sessions;
 	Serialize::Checker<ExceptionVector> Exceptions;
+
+	unsigned long next_seq;
+	TR1NS::unordered_map<Exception *, IndexedException> indexed;
+	/* Exceptions without wildcards, by mask */
+	Anope::hash_map<std::vector<Exception *> > literal;
+	/* Exceptions which are CIDR ranges or IPs */
+	cidr_trie<Exception *> ranges;
+	/* Exceptions with wildcards, in the order they were added */
+	std::vector<std::pair<unsigned long, Exception *> > wild;
+
+	static bool ParseRange(const Anope::string &mask, sockaddrs &addr, unsigned &len)
+	{
+		/* The same as cidr's parsing of masks */
+		bool ipv6 = mask.find(':') != Anope::string::npos;
+		size_t sl = mask.find_last_of('/');
+
+		addr.pton(ipv6 ? AF_INET6 : AF_INET, mask.substr(0, sl));
+		len = ipv6 ? 128 : 32;
+		if (sl != Anope::string::npos)
+		{
+			try
+			{
+				Anope::string cidr_range = mask.substr(sl + 1);
+				if (cidr_range.is_pos_number_only())
+					len = convertTo<unsigned>(cidr_range);
+			}
+			catch (const ConvertException &) { }
+		}
+		return addr.valid();
+	}
+
+	void Index(Exception *e, unsigned long seq)
+	{
+		IndexedException &ie = this->indexed[e];
+		ie.seq = seq;
+		ie.mask = e->mask;
+		ie.glob.Compile(e->mask);
+
+		ie.range = ParseRange(e->mask, ie.addr, ie.len);
+		if (ie.range)
+			this->ranges.insert(ie.addr, ie.len, e);
+
+		if (ie.glob.IsLiteral())
+			this->literal[e->mask].push_back(e);
+		else
+		{
+			std::pair<unsigned long, Exception *> entry(seq, e);
+			this->wild.insert(std::lower_bound(this->wild.begin(), this->wild.end(), entry), entry);
+		}
+	}
+
+	void Unindex(Exception *e)
+	{
+		TR1NS::unordered_map<Exception *, IndexedException>::iterator it = this->indexed.find(e);
+		if (it == this->indexed.end())
+			return;
+		const IndexedException &ie = it->second;
+
+		if (ie.range)
+			this->ranges.erase(ie.addr, ie.len, e);
+
+		Anope::hash_map<std::vector<Exception *> >::iterator lit = this->literal.find(ie.mask);
+		if (lit != this->literal.end())
+		{
+			std::vector<Exception *>::iterator it2 = std::find(lit->second.begin(), lit->second.end(), e);
+			if (it2 != lit->second.end())
+				lit->second.erase(it2);
+			if (lit->second.empty())
+				this->literal.erase(lit);
+		}
+
+		std::pair<unsigned long, Exception *> entry(ie.seq, e);
+		std::vector<std::pair<unsigned long, Exception *> >::iterator wit = std::lower_bound(this->wild.begin(), this->wild.end(), entry);
+		if (wit != this->wild.end() && wit->second == e)
+			this->wild.erase(wit);
+
+		this->indexed.erase(it);
+	}
+
+	/* Find the first added exception out of some candidates and the wildcard exceptions which match */
+	Exception *FindException(const std::vector<Exception *> &candidates, const Anope::string &host, const Anope::string &ip)
+	{
+		Exception *best = NULL;
+		unsigned long best_seq = 0;
+		for (unsigned i = 0; i < candidates.size(); ++i)
+		{
+			unsigned long seq = this->indexed[candidates[i]].seq;
+			if (!best || seq < best_seq)
+			{
+				best = candidates[i];
+				best_seq = seq;
+			}
+		}
+
+		for (unsigned i = 0; i < this->wild.size(); ++i)
+		{
+			if (best && this->wild[i].first > best_seq)
+				break;
+
+			Exception *e = this->wild[i].second;
+			const IndexedException &ie = this->indexed[e];
+
+			if (ie.glob.Matches(host) || (!ip.empty() && ie.glob.Matches(ip)))
+				return e;
+		}
+
+		return best;
+	}
+
+	void AddLiteral(const Anope::string &mask, std::vector<Exception *> &candidates)
+	{
+		Anope::hash_map<std::vector<Exception *> >::const_iterator it = this->literal.find(mask);
+		if (it != this->literal.end())
+			candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+	}
+
  public:
-	MySessionService(Module *m) : SessionService(m), Exceptions("Exception") { }
+	MySessionService(Module *m) : SessionService(m), Exceptions("Exception"), next_seq(0) { }
 
 	Exception *CreateException() anope_override
 	{
@@ -49,7 +177,18 @@ class MySessionService : public SessionService
 
 	void AddException(Exception *e) anope_override
 	{
+		TR1NS::unordered_map<Exception *, IndexedException>::iterator it = this->indexed.find(e);
+		if (it != this->indexed.end())
+		{
+			/* This exception was already added and has been changed since, so only index it again */
+			unsigned long seq = it->second.seq;
+			this->Unindex(e);
+			this->Index(e, seq);
+			return;
+		}
+
 		this->Exceptions->push_back(e);
+		this->Index(e, this->next_seq++);
 	}
 
 	void DelException(Exception *e) anope_override
@@ -57,35 +196,36 @@ class MySessionService : public SessionService
 		ExceptionVector::iterator it = std::find(this->Exceptions->begin(), this->Exceptions->end(), e);
 		if (it != this->Exceptions->end())
 			this->Exceptions->erase(it);
+		this->Unindex(e);
 	}
 
 	Exception *FindException(User *u) anope_override
 	{
-		for (std::vector<Exception *>::const_iterator it = this->Exceptions->begin(), it_end = this->Exceptions->end(); it != it_end; ++it)
-		{
-			Exception *e = *it;
-			if (Anope::Match(u->host, e->mask) || Anope::Match(u->ip.addr(), e->mask))
-				return e;
+		if (this->Exceptions->empty())
+			return NULL;
 
-			if (cidr(e->mask).match(u->ip))
-				return e;
-		}
-		return NULL;
+		Anope::string ip = u->ip.addr();
+		std::vector<Exception *> candidates;
+		this->AddLiteral(u->host, candidates);
+		this->AddLiteral(ip, candidates);
+		if (u->ip.valid())
+			this->ranges.find(u->ip, candidates);
+
+		return this->FindException(candidates, u->host, ip);
 	}
 
 	Exception *FindException(const Anope::string &host) anope_override
 	{
-		for (std::vector<Exception *>::const_iterator it = this->Exceptions->begin(), it_end = this->Exceptions->end(); it != it_end; ++it)
-		{
-			Exception *e = *it;
-			if (Anope::Match(host, e->mask))
-				return e;
+		if (this->Exceptions->empty())
+			return NULL;
 
-			if (cidr(e->mask).match(sockaddrs(host)))
-				return e;
-		}
+		std::vector<Exception *> candidates;
+		this->AddLiteral(host, candidates);
+		sockaddrs addr(host);
+		if (addr.valid())
+			this->ranges.find(addr, candidates);
 
-		return NULL;
+		return this->FindException(candidates, host, "");
 	}
 
 	ExceptionVector &GetExceptions() anope_override
@@ -56,6 +56,40 @@ static int stats_count_servers(Server *s)
 	return count;
 }
 
+static bool stats_sort_messages(const std::pair<Anope::string, const MessageStats *> &a, const std::pair<Anope::string, const MessageStats *> &b)
+{
+	return a.second->time > b.second->time;
+}
+
+struct HookEntry
+{
+	const Module *module;
+	const EventStats *stats;
+};
+
+static bool stats_sort_hooks(const HookEntry &a, const HookEntry &b)
+{
+	return a.stats->time > b.stats->time;
+}
+
+/* The event handlers which have been profiled, slowest first */
+static std::vector<HookEntry> stats_get_hooks()
+{
+	std::vector<HookEntry> hooks;
+	for (std::list<Module *>::const_iterator it = ModuleManager::Modules.begin(); it != ModuleManager::Modules.end(); ++it)
+	{
+		const Module *m = *it;
+		for (unsigned i = 0; i < m->event_stats.size(); ++i)
+			if (m->event_stats[i].count)
+			{
+				HookEntry entry = { m, &m->event_stats[i] };
+				hooks.push_back(entry);
+			}
+	}
+	std::sort(hooks.begin(), hooks.end(), stats_sort_hooks);
+	return hooks;
+}
+
 class CommandOSStats : public Command
 {
 	ServiceReference<XLineManager> akills, snlines, sqlines;
@@ -128,6 +162,11 @@ class CommandOSStats : public Command
 	void DoStatsReset(CommandSource &source)
 	{
 		MaxUserCount = UserListByNick.size();
+		/* The entries are referred to by the core, so they are cleared rather than removed */
+		for (Anope::map<MessageStats>::iterator it = MessageStatsList.begin(); it != MessageStatsList.end(); ++it)
+			it->second = MessageStats();
+		for (std::list<Module *>::iterator it = ModuleManager::Modules.begin(); it != ModuleManager::Modules.end(); ++it)
+			(*it)->event_stats.clear();
 		source.Reply(_("Statistics reset."));
 		return;
 	}
@@ -156,6 +195,140 @@ class CommandOSStats : public Command
 		return;
 	}
 
+	void DoStatsMessages(CommandSource &source)
+	{
+		std::vector<std::pair<Anope::string, const MessageStats *> > messages;
+		for (Anope::map<MessageStats>::const_iterator it = MessageStatsList.begin(); it != MessageStatsList.end(); ++it)
+			if (it->second.count)
+				messages.push_back(std::make_pair(it->first, &it->second));
+		std::sort(messages.begin(), messages.end(), stats_sort_messages);
+
+		if (messages.empty())
+		{
+			source.Reply(_("No messages have been received from the uplink."));
+			return;
+		}
+
+		ListFormatter list(source.GetAccount());
+		list.AddColumn(_("Command")).AddColumn(_("Count")).AddColumn(_("Bytes")).AddColumn(_("Total")).AddColumn(_("Average")).AddColumn(_("Max"));
+		for (unsigned i = 0; i < messages.size(); ++i)
+		{
+			const MessageStats *stats = messages[i].second;
+
+			ListFormatter::ListEntry entry;
+			entry["Command"] = messages[i].first;
+			entry["Count"] = stringify(stats->count);
+			entry["Bytes"] = stringify(stats->bytes);
+			entry["Total"] = stringify(stats->time / 1000) + "ms";
+			entry["Average"] = stringify(stats->time / stats->count) + "us";
+			entry["Max"] = stringify(stats->max) + "us";
+			list.AddEntry(entry);
+		}
+
+		source.Reply(_("Messages received from the uplink:"));
+
+		std::vector<Anope::string> replies;
+		list.Process(replies);
+		for (unsigned i = 0; i < replies.size(); ++i)
+			source.Reply(replies[i]);
+	}
+
+	void DoStatsMessagesDump(CommandSource &source)
+	{
+		const Anope::string filename = Anope::DataDir + "/" + Config->GetModule(this->owner)->Get<const Anope::string>("messagestatsfile", "messagestats.txt");
+
+		std::ofstream fs(filename.c_str(), std::ios_base::out | std::ios_base::trunc);
+		if (!fs.is_open())
+		{
+			source.Reply(_("Unable to open %s for writing."), filename.c_str());
+			return;
+		}
+
+		fs << "# command count bytes total_us max_us";
+		for (unsigned i = 0, limit = 10; i < MessageStats::Buckets; ++i, limit *= 10)
+			fs << (i + 1 < MessageStats::Buckets ? " lt_" : " ge_") << (i + 1 < MessageStats::Buckets ? limit : limit / 10) << "us";
+		fs << std::endl;
+
+		for (Anope::map<MessageStats>::const_iterator it = MessageStatsList.begin(); it != MessageStatsList.end(); ++it)
+		{
+			const MessageStats &stats = it->second;
+			if (!stats.count)
+				continue;
+
+			fs << it->first << " " << stats.count << " " << stats.bytes << " " << stats.time << " " << stats.max;
+			for (unsigned i = 0; i < MessageStats::Buckets; ++i)
+				fs << " " << stats.histogram[i];
+			fs << std::endl;
+		}
+
+		source.Reply(_("Message statistics written to %s."), filename.c_str());
+	}
+
+	void DoStatsHooks(CommandSource &source)
+	{
+		if (!ModuleManager::ProfileHooks)
+			source.Reply(_("Hook profiling is not enabled."));
+
+		std::vector<HookEntry> hooks = stats_get_hooks();
+		if (hooks.empty())
+		{
+			source.Reply(_("No event handlers have been profiled."));
+			return;
+		}
+
+		/* There can be a lot of these, the full list can be dumped to a file */
+		const unsigned max = 25;
+
+		ListFormatter list(source.GetAccount());
+		list.AddColumn(_("Module")).AddColumn(_("Event")).AddColumn(_("Count")).AddColumn(_("Total")).AddColumn(_("Average")).AddColumn(_("Max"));
+		for (unsigned i = 0; i < hooks.size() && i < max; ++i)
+		{
+			const EventStats *stats = hooks[i].stats;
+
+			ListFormatter::ListEntry entry;
+			entry["Module"] = hooks[i].module->name;
+			entry["Event"] = stats->name;
+			entry["Count"] = stringify(stats->count);
+			entry["Total"] = stringify(stats->time / 1000) + "ms";
+			entry["Average"] = stringify(stats->time / stats->count) + "us";
+			entry["Max"] = stringify(stats->max) + "us";
+			list.AddEntry(entry);
+		}
+
+		source.Reply(_("Time spent in event handlers:"));
+
+		std::vector<Anope::string> replies;
+		list.Process(replies);
+		for (unsigned i = 0; i < replies.size(); ++i)
+			source.Reply(replies[i]);
+
+		if (hooks.size() > max)
+			source.Reply(_("Showing the %u slowest of %u event handlers."), max, static_cast<unsigned>(hooks.size()));
+	}
+
+	void DoStatsHooksDump(CommandSource &source)
+	{
+		const Anope::string filename = Anope::DataDir + "/" + Config->GetModule(this->owner)->Get<const Anope::string>("hookstatsfile", "hookstats.txt");
+
+		std::ofstream fs(filename.c_str(), std::ios_base::out | std::ios_base::trunc);
+		if (!fs.is_open())
+		{
+			source.Reply(_("Unable to open %s for writing."), filename.c_str());
+			return;
+		}
+
+		fs << "# module event count total_us max_us" << std::endl;
+
+		std::vector<HookEntry> hooks = stats_get_hooks();
+		for (unsigned i = 0; i < hooks.size(); ++i)
+		{
+			const EventStats *stats = hooks[i].stats;
+			fs << hooks[i].module->name << " " << stats->name << " " << stats->count << " " << stats->time << " " << stats->max << std::endl;
+		}
+
+		source.Reply(_("Hook statistics written to %s."), filename.c_str());
+	}
+
 	template<typename T> void GetHashStats(const T& map, size_t& entries, size_t& buckets, size_t& max_chain)
 	{
 		entries = map.size(), buckets = map.bucket_count(), max_chain = 0;
@@ -194,14 +367,22 @@ class CommandOSStats : public Command
 			GetHashStats(session_service->GetSessions(), entries, buckets, max_chain);
 			source.Reply(_("Sessions: %lu entries, %lu buckets, longest chain is %d"), entries, buckets, max_chain);
 		}
+
+		size_t strings, uses, saved;
+		Anope::InternedString::GetStats(strings, uses, saved);
+		source.Reply(_("Interned strings: %lu distinct strings used %lu times, saving %lu bytes"), strings, uses, saved);
+
+		uint64_t hits, misses;
+		Anope::GetRegexCacheStats(entries, hits, misses);
+		source.Reply(_("Regex cache: %lu entries, %s hits, %s misses"), entries, stringify(hits).c_str(), stringify(misses).c_str());
 	}
 
  public:
-	CommandOSStats(Module *creator) : Command(creator, "operserv/stats", 0, 1),
+	CommandOSStats(Module *creator) : Command(creator, "operserv/stats", 0, 2),
 		akills("XLineManager", "xlinemanager/sgline"), snlines("XLineManager", "xlinemanager/snline"), sqlines("XLineManager", "xlinemanager/sqline")
 	{
 		this->SetDesc(_("Show status of Services and network"));
-		this->SetSyntax("[AKILL | HASH | UPLINK | UPTIME | ALL | RESET]");
+		this->SetSyntax("[AKILL | HASH | HOOKS [DUMP] | MESSAGES [DUMP] | UPLINK | UPTIME | ALL | RESET]");
 	}
 
 	void Execute(CommandSource &source, const std::vector<Anope::string> &params) anope_override
@@ -219,13 +400,25 @@ class CommandOSStats : public Command
 		if (extra.equals_ci("ALL") || extra.equals_ci("HASH"))
 			this->DoStatsHash(source);
 
+		if (extra.equals_ci("HOOKS") && params.size() > 1 && params[1].equals_ci("DUMP"))
+			return this->DoStatsHooksDump(source);
+
+		if (extra.equals_ci("MESSAGES") && params.size() > 1 && params[1].equals_ci("DUMP"))
+			return this->DoStatsMessagesDump(source);
+
+		if (extra.equals_ci("ALL") || extra.equals_ci("HOOKS"))
+			this->DoStatsHooks(source);
+
+		if (extra.equals_ci("ALL") || extra.equals_ci("MESSAGES"))
+			this->DoStatsMessages(source);
+
 		if (extra.equals_ci("ALL") || extra.equals_ci("UPLINK"))
 			this->DoStatsUplink(source);
 
 		if (extra.empty() || extra.equals_ci("ALL") || extra.equals_ci("UPTIME"))
 			this->DoStatsUptime(source);
 
-		if (!extra.empty() && !extra.equals_ci("ALL") && !extra.equals_ci("AKILL") && !extra.equals_ci("HASH") && !extra.equals_ci("UPLINK") && !extra.equals_ci("UPTIME"))
+		if (!extra.empty() && !extra.equals_ci("ALL") && !extra.equals_ci("AKILL") && !extra.equals_ci("HASH") && !extra.equals_ci("HOOKS") && !extra.equals_ci("MESSAGES") && !extra.equals_ci("UPLINK") && !extra.equals_ci("UPTIME"))
 			source.Reply(_("Unknown STATS option: \002%s\002"), extra.c_str());
 	}
 
@@ -241,12 +434,26 @@ class CommandOSStats : public Command
 				"AKILL list and the current default expiry time.\n"
 				" \n"
 				"The \002RESET\002 option currently resets the maximum user count\n"
-				"to the number of users currently present on the network.\n"
+				"to the number of users currently present on the network, and\n"
+				"clears the message and hook statistics.\n"
 				" \n"
 				"The \002UPLINK\002 option displays information about the current\n"
 				"server Anope uses as an uplink to the network.\n"
 				" \n"
-				"The \002HASH\002 option displays information about the hash maps.\n"
+				"The \002HASH\002 option displays information about the hash maps\n"
+				"and how much memory is saved by sharing users' hostnames, idents\n"
+				"and realnames, along with how well compiled regular expressions\n"
+				"are being reused.\n"
+				" \n"
+				"The \002HOOKS\002 option displays the modules' event handlers\n"
+				"which have taken the most time, if hook profiling is enabled.\n"
+				"\002HOOKS DUMP\002 writes the time spent in every event handler\n"
+				"to a file in the data directory.\n"
+				" \n"
+				"The \002MESSAGES\002 option displays how many of each message\n"
+				"have been received from the uplink and how long they took to\n"
+				"process. \002MESSAGES DUMP\002 writes these statistics, including\n"
+				"a histogram of the processing times, to a file in the data directory.\n"
 				" \n"
 				"The \002ALL\002 option displays all of the above statistics."));
 		return true;
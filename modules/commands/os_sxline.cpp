@@ -621,7 +621,7 @@ class CommandOSSQLine : public CommandOSSXLineBase
 					std::vector<User *> users;
 					for (Channel::ChanUserList::iterator it = c->users.begin(), it_end = c->users.end(); it != it_end; ++it)
 					{
-						ChanUserContainer *uc = it->second;
+						ChanUserContainer *uc = *it;
 						User *user = uc->user;
 
 						if (!user->HasMode("OPER") && user->server != Me)
@@ -21,7 +21,7 @@ class StatusUpdate : public Module
 		if (ci->c)
 			for (Channel::ChanUserList::iterator it = ci->c->users.begin(), it_end = ci->c->users.end(); it != it_end; ++it)
 			{
-				User *user = it->second->user;
+				User *user = (*it)->user;
 
 				ChannelInfo *next;
 				if (user->server != Me && access->Matches(user, user->Account(), next))
@@ -44,7 +44,7 @@ class StatusUpdate : public Module
 		if (ci->c)
 			for (Channel::ChanUserList::iterator it = ci->c->users.begin(), it_end = ci->c->users.end(); it != it_end; ++it)
 			{
-				User *user = it->second->user;
+				User *user = (*it)->user;
 
 				ChannelInfo *next;
 				if (user->server != Me && access->Matches(user, user->Account(), next))
@@ -0,0 +1,201 @@
+/*
+ *
+ * (C) 2003-2020 Anope Team
+ * Contact us at team@anope.org
+ *
+ * Please read COPYING and README for further details.
+ */
+
+/* Checks that BadWords::MatchBadWord finds the same badword as the loop
+ * bs_kick used to check each badword with in turn, and benchmarks the two.
+ * The badwords are added to a channel which is registered for as long as
+ * this runs. This runs when the module is loaded and logs the results, eg:
+ *
+ *   /msg OperServ MODLOAD m_bench_badwords
+ */
+
+#include "module.h"
+#include "modules/bs_badwords.h"
+
+/* The loop bs_kick used to check a message against each badword with, as it was */
+static const BadWord *CheckEachBadWord(BadWords *badwords, const Anope::string &nbuf, bool casesensitive)
+{
+	for (unsigned i = 0; i < badwords->GetBadWordCount(); ++i)
+	{
+		bool mustkick = false;
+		const BadWord *bw = badwords->GetBadWord(i);
+
+		if (bw->word.empty())
+			continue; // Shouldn't happen
+
+		if (bw->word.length() > nbuf.length())
+			continue; // This can't ever match
+
+		if (bw->type == BW_ANY && ((casesensitive && nbuf.find(bw->word) != Anope::string::npos) || (!casesensitive && nbuf.find_ci(bw->word) != Anope::string::npos)))
+			mustkick = true;
+		else if (bw->type == BW_SINGLE)
+		{
+			size_t len = bw->word.length();
+
+			if ((casesensitive && bw->word.equals_cs(nbuf)) || (!casesensitive && bw->word.equals_ci(nbuf)))
+				mustkick = true;
+			else if (nbuf.find(' ') == len && ((casesensitive && bw->word.equals_cs(nbuf.substr(0, len))) || (!casesensitive && bw->word.equals_ci(nbuf.substr(0, len)))))
+				mustkick = true;
+			else
+			{
+				if (len < nbuf.length() && nbuf.rfind(' ') == nbuf.length() - len - 1 && ((casesensitive && nbuf.find(bw->word) == nbuf.length() - len) || (!casesensitive && nbuf.find_ci(bw->word) == nbuf.length() - len)))
+					mustkick = true;
+				else
+				{
+					Anope::string wordbuf = " " + bw->word + " ";
+
+					if ((casesensitive && nbuf.find(wordbuf) != Anope::string::npos) || (!casesensitive && nbuf.find_ci(wordbuf) != Anope::string::npos))
+						mustkick = true;
+				}
+			}
+		}
+		else if (bw->type == BW_START)
+		{
+			size_t len = bw->word.length();
+
+			if ((casesensitive && nbuf.substr(0, len).equals_cs(bw->word)) || (!casesensitive && nbuf.substr(0, len).equals_ci(bw->word)))
+				mustkick = true;
+			else
+			{
+				Anope::string wordbuf = " " + bw->word;
+
+				if ((casesensitive && nbuf.find(wordbuf) != Anope::string::npos) || (!casesensitive && nbuf.find_ci(wordbuf) != Anope::string::npos))
+					mustkick = true;
+			}
+		}
+		else if (bw->type == BW_END)
+		{
+			size_t len = bw->word.length();
+
+			if ((casesensitive && nbuf.substr(nbuf.length() - len).equals_cs(bw->word)) || (!casesensitive && nbuf.substr(nbuf.length() - len).equals_ci(bw->word)))
+				mustkick = true;
+			else
+			{
+				Anope::string wordbuf = bw->word + " ";
+
+				if ((casesensitive && nbuf.find(wordbuf) != Anope::string::npos) || (!casesensitive && nbuf.find_ci(wordbuf) != Anope::string::npos))
+					mustkick = true;
+			}
+		}
+
+		if (mustkick)
+			return bw;
+	}
+
+	return NULL;
+}
+
+static Anope::string RandomString(const char *chars, unsigned len)
+{
+	Anope::string s;
+	for (unsigned n = strlen(chars); len; --len)
+		s += chars[rand() % n];
+	return s;
+}
+
+class BenchBadWords : public Module
+{
+	/* Short words and messages from a tiny alphabet, so words overlap, repeat,
+	 * and are found at the start, end and middle of messages and words
+	 */
+	void Compare(BadWords *badwords)
+	{
+		unsigned checks = 0, matched = 0, mismatches = 0;
+
+		for (int round = 0; round < 400; ++round)
+		{
+			badwords->ClearBadWords();
+			for (unsigned count = 1 + rand() % 12; count; --count)
+			{
+				Anope::string word = RandomString("abAB ", 1 + rand() % 3);
+				if (!word.replace_all_cs(" ", "").empty())
+					badwords->AddBadWord(word, static_cast<BadWordType>(rand() % 4));
+			}
+
+			for (int casesensitive = 0; casesensitive < 2; ++casesensitive)
+				for (int m = 0; m < 200; ++m)
+				{
+					Anope::string message = RandomString("abAB  ", 1 + rand() % 12);
+					const BadWord *each = CheckEachBadWord(badwords, message, casesensitive), *match = badwords->MatchBadWord(message, casesensitive);
+
+					++checks;
+					if (match)
+						++matched;
+					if (each != match && ++mismatches <= 10)
+						Log() << "m_bench_badwords: \"" << message << "\" matched " << (match ? "\"" + match->word + "\"" : "nothing")
+							<< " but checking each badword matched " << (each ? "\"" + each->word + "\"" : "nothing");
+				}
+		}
+
+		Log() << "m_bench_badwords: " << checks << " checks, " << matched << " matched, " << mismatches << " mismatches";
+	}
+
+	/* Lists of realistic words, none of which the messages are likely to contain */
+	void Benchmark(BadWords *badwords)
+	{
+		static const char letters[] = "abcdefghijklmnopqrstuvwxyz";
+		static const unsigned sizes[] = { 10, 100, 500, 2000 };
+
+		std::vector<Anope::string> messages;
+		for (int m = 0; m < 2000; ++m)
+		{
+			Anope::string message;
+			while (message.length() < 100)
+				message += RandomString(letters, 3 + rand() % 6) + " ";
+			messages.push_back(message);
+		}
+
+		for (unsigned s = 0; s < sizeof(sizes) / sizeof(*sizes); ++s)
+		{
+			badwords->ClearBadWords();
+			for (unsigned i = 0; i < sizes[s]; ++i)
+				badwords->AddBadWord(RandomString(letters, 6 + rand() % 5), static_cast<BadWordType>(rand() % 4));
+
+			uint64_t start = Anope::MicroTime();
+			for (unsigned m = 0; m < messages.size(); ++m)
+				CheckEachBadWord(badwords, messages[m], false);
+			uint64_t each = Anope::MicroTime() - start;
+
+			/* Matching the first time builds the automaton */
+			start = Anope::MicroTime();
+			badwords->MatchBadWord(messages[0], false);
+			uint64_t build = Anope::MicroTime() - start;
+
+			start = Anope::MicroTime();
+			for (unsigned m = 0; m < messages.size(); ++m)
+				badwords->MatchBadWord(messages[m], false);
+			uint64_t match = Anope::MicroTime() - start;
+
+			Log() << "m_bench_badwords: " << sizes[s] << " badwords, " << messages.size() << " messages: checking each badword " << each / 1000
+				<< "ms, matching " << match / 1000 << "ms, building the automaton " << build << "us";
+		}
+	}
+
+ public:
+	BenchBadWords(const Anope::string &modname, const Anope::string &creator) : Module(modname, creator, EXTRA | VENDOR)
+	{
+		static const Anope::string channel = "#m_bench_badwords";
+
+		if (!ModuleManager::FindModule("bs_badwords"))
+			throw ModuleException("bs_badwords is not loaded");
+		if (ChannelInfo::Find(channel))
+			throw ModuleException(channel + " is registered");
+
+		ChannelInfo *ci = new ChannelInfo(channel);
+		BadWords *badwords = ci->Require<BadWords>("badwords");
+
+		srand(1);
+		this->Compare(badwords);
+		this->Benchmark(badwords);
+
+		badwords->ClearBadWords();
+		delete ci;
+	}
+};
+
+MODULE_INIT(BenchBadWords)
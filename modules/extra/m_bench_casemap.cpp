@@ -0,0 +1,138 @@
+/*
+ *
+ * (C) 2003-2020 Anope Team
+ * Contact us at team@anope.org
+ *
+ * Please read COPYING and README for further details.
+ */
+
+/* Benchmarks case insensitive lookups in Anope::hash_map and Anope::map
+ * against the comparators they used before ci::hash, ci::equals and
+ * ci::compare, which copied and folded both keys on every call. The results
+ * of both are also checked to be the same. This runs when the module is
+ * loaded and logs the results, eg:
+ *
+ *   /msg OperServ MODLOAD m_bench_casemap
+ */
+
+#include "module.h"
+
+namespace
+{
+	/* The comparators as they were, working on folded copies */
+	struct CopyingHash
+	{
+		size_t operator()(const Anope::string &s) const
+		{
+			return TR1NS::hash<std::string>()(s.lower().str());
+		}
+	};
+
+	struct CopyingEquals
+	{
+		bool operator()(const Anope::string &s1, const Anope::string &s2) const
+		{
+			return ci::string(s1.c_str()) == s2.c_str();
+		}
+	};
+
+	struct CopyingLess
+	{
+		bool operator()(const Anope::string &s1, const Anope::string &s2) const
+		{
+			return s1.ci_str().compare(s2.ci_str()) < 0;
+		}
+	};
+
+	Anope::string RandomNick()
+	{
+		static const char chars[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789[]\\`_^{|}-";
+		Anope::string nick;
+		for (unsigned i = 5 + rand() % 11; i; --i)
+			nick += chars[rand() % (sizeof(chars) - 1)];
+		return nick;
+	}
+
+	Anope::string FlipCase(const Anope::string &s)
+	{
+		Anope::string flipped = s;
+		for (unsigned i = 0; i < flipped.length(); ++i)
+			flipped[i] = isupper(flipped[i]) ? tolower(flipped[i]) : toupper(flipped[i]);
+		return flipped;
+	}
+
+	template<typename Map> unsigned Lookup(const Map &map, const std::vector<Anope::string> &keys, uint64_t &elapsed)
+	{
+		unsigned found = 0;
+		uint64_t start = Anope::MicroTime();
+		for (unsigned i = 0; i < keys.size(); ++i)
+			if (map.find(keys[i]) != map.end())
+				++found;
+		elapsed = Anope::MicroTime() - start;
+		return found;
+	}
+}
+
+class BenchCasemap : public Module
+{
+	void Report(const char *what, unsigned count, uint64_t copying, uint64_t in_place)
+	{
+		Log() << "m_bench_casemap: " << what << ": " << copying * 1000 / count << " ns per lookup copying, "
+			<< in_place * 1000 / count << " ns per lookup in place";
+	}
+
+ public:
+	BenchCasemap(const Anope::string &modname, const Anope::string &creator) : Module(modname, creator, EXTRA | VENDOR)
+	{
+		static const unsigned count = 150000;
+
+		srand(1);
+
+		std::vector<Anope::string> keys, lookups;
+		for (unsigned i = 0; i < count; ++i)
+		{
+			keys.push_back(RandomNick());
+			lookups.push_back(FlipCase(keys.back()));
+		}
+
+		/* The results of both must match for every pair of keys tried */
+		unsigned mismatches = 0;
+		for (unsigned i = 0; i < count; ++i)
+		{
+			const Anope::string &a = keys[i], &b = rand() % 2 ? lookups[i] : keys[rand() % count];
+			if (CopyingEquals()(a, b) != Anope::compare()(a, b) || CopyingLess()(a, b) != ci::less()(a, b))
+				++mismatches;
+			/* Keys which are equal must hash the same */
+			if (Anope::compare()(a, b) && Anope::hash_ci()(a) != Anope::hash_ci()(b))
+				++mismatches;
+		}
+		Log() << "m_bench_casemap: compared " << count << " pairs of keys, " << mismatches << " mismatches";
+
+		TR1NS::unordered_map<Anope::string, unsigned, CopyingHash, CopyingEquals> copying_hash;
+		Anope::hash_map<unsigned> hash;
+		std::map<Anope::string, unsigned, CopyingLess> copying_map;
+		Anope::map<unsigned> map;
+
+		for (unsigned i = 0; i < count; ++i)
+		{
+			copying_hash[keys[i]] = i;
+			hash[keys[i]] = i;
+			copying_map[keys[i]] = i;
+			map[keys[i]] = i;
+		}
+
+		uint64_t copying, in_place;
+		unsigned copying_found = Lookup(copying_hash, lookups, copying), found = Lookup(hash, lookups, in_place);
+		if (copying_found != found)
+			Log() << "m_bench_casemap: hash_map lookups found " << copying_found << " keys copying but " << found << " in place";
+		Report("hash_map", count, copying, in_place);
+
+		copying_found = Lookup(copying_map, lookups, copying);
+		found = Lookup(map, lookups, in_place);
+		if (copying_found != found)
+			Log() << "m_bench_casemap: map lookups found " << copying_found << " keys copying but " << found << " in place";
+		Report("map", count, copying, in_place);
+	}
+};
+
+MODULE_INIT(BenchCasemap)
@@ -0,0 +1,172 @@
+/*
+ *
+ * (C) 2003-2020 Anope Team
+ * Contact us at team@anope.org
+ *
+ * Please read COPYING and README for further details.
+ */
+
+/* Checks that XLineManager::CheckAllXLines, which only checks the xlines
+ * found through the manager's index, finds the same xline as checking every
+ * xline newest first, and benchmarks the two. The users checked are the
+ * users currently online, so this is most useful on a test network with
+ * many users. This runs when the module is loaded and logs the results, eg:
+ *
+ *   /msg OperServ MODLOAD m_bench_xline
+ */
+
+#include "module.h"
+
+/* A manager which matches and indexes xlines like AKILLs do, but does not
+ * send anything to the uplink or do anything to the users it matches.
+ */
+class BenchXLineManager : public XLineManager
+{
+ public:
+	BenchXLineManager(Module *creator) : XLineManager(creator, "xlinemanager/bench", 'B') { }
+
+	void OnMatch(User *u, XLine *x) anope_override { }
+	void Send(User *u, XLine *x) anope_override { }
+	void SendDel(XLine *x) anope_override { }
+
+	bool Check(User *u, const XLine *x) anope_override
+	{
+		if (x->regex)
+			return false;
+		if (!x->GetNick().empty() && !x->GetNickGlob().Matches(u->nick))
+			return false;
+		if (!x->GetUser().empty() && !x->GetUserGlob().Matches(u->GetIdent()))
+			return false;
+		if (!x->GetReal().empty() && !x->GetRealGlob().Matches(u->realname))
+			return false;
+		if (x->c && x->c->match(u->ip))
+			return true;
+		return x->GetHost().empty() || x->GetHostGlob().Matches(u->host) || x->GetHostGlob().Matches(u->ip.addr());
+	}
+
+	bool GetIndexMask(const XLine *x, Anope::string &mask) anope_override
+	{
+		if (x->regex || x->GetHost().empty())
+			return false;
+		mask = x->GetHost();
+		return true;
+	}
+
+	void GetIndexKeys(User *u, std::vector<Anope::string> &keys) anope_override
+	{
+		keys.push_back(u->host);
+		keys.push_back(u->ip.addr());
+	}
+
+	/** Find the xline matching a user by checking every xline, newest first
+	 */
+	XLine *CheckLinear(User *u)
+	{
+		const std::vector<XLine *> &list = this->GetList();
+		for (unsigned i = list.size(); i > 0; --i)
+			if (this->Check(u, list[i - 1]))
+				return list[i - 1];
+		return NULL;
+	}
+};
+
+/* A random mask of one of the kinds the index treats differently, mostly
+ * for masks which match some of the users the fake uplink in a test network
+ * would introduce, which are nick userN, ident identN, host hostN.example.com,
+ * IP 10.0.N/256.N%256 and realname "Real name N".
+ */
+static Anope::string RandomMask(int users)
+{
+	int i = rand() % users;
+	switch (rand() % 14)
+	{
+		case 0: return "*@host" + stringify(i) + ".example.com";
+		case 1: return "ident" + stringify(i) + "@*";
+		case 2: return "*@*" + stringify(i) + ".EXAMPLE.com";
+		case 3: return "*@host" + stringify(i) + "*";
+		case 4: return "*@10.0." + stringify(i % 16) + ".0/" + stringify(27 + rand() % 6);
+		case 5: return "*@10.0." + stringify(i >> 8) + "." + stringify(i & 255);
+		case 6: return "user" + stringify(i) + "*!*@*";
+		case 7: return "*@h?st" + stringify(i) + ".example.com";
+		case 8: return "*@10.0." + stringify(i >> 8) + "." + stringify(i & 15) + "*";
+		case 9: return "*!*@*#Real name " + stringify(i);
+		case 10: return "ident" + stringify(i) + "@HOST" + stringify(i) + ".example.com";
+		case 11: return "*@host" + stringify(i) + ".*.com";
+		case 12: return "*@10.0." + stringify(i >> 8) + ".0/24";
+		default: return "*@nomatch" + stringify(i) + ".example.org";
+	}
+}
+
+/* A mask like those in a blacklist, which matches none of the users */
+static Anope::string BlacklistMask(int k)
+{
+	switch (k % 4)
+	{
+		case 0: return "*@192." + stringify((k >> 16) & 255) + "." + stringify((k >> 8) & 255) + "." + stringify(k & 255);
+		case 1: return "*@172." + stringify((k >> 8) & 255) + "." + stringify(k & 255) + ".0/24";
+		case 2: return "*@*.spam" + stringify(k) + ".net";
+		default: return "*@bot" + stringify(k) + ".example.net";
+	}
+}
+
+class BenchXLine : public Module
+{
+ public:
+	BenchXLine(const Anope::string &modname, const Anope::string &creator) : Module(modname, creator, EXTRA | VENDOR)
+	{
+		if (UserListByNick.empty())
+			throw ModuleException("There are no users to check");
+
+		srand(42);
+
+		/* Random lists of masks of mixed kinds, with some removed again */
+		unsigned checks = 0, matched = 0, mismatches = 0;
+		for (int round = 0; round < 20; ++round)
+		{
+			BenchXLineManager manager(this);
+			for (int count = 1 + rand() % 1000; count > 0; --count)
+				manager.AddXLine(new XLine(RandomMask(UserListByNick.size()), "m_bench_xline"));
+			for (unsigned count = manager.GetCount() / 5; count > 0; --count)
+				manager.DelXLine(manager.GetList()[rand() % manager.GetCount()]);
+
+			for (user_map::const_iterator it = UserListByNick.begin(), it_end = UserListByNick.end(); it != it_end; ++it)
+			{
+				XLine *indexed = manager.CheckAllXLines(it->second), *linear = manager.CheckLinear(it->second);
+				++checks;
+				if (indexed)
+					++matched;
+				if (indexed != linear && ++mismatches <= 10)
+					Log() << "m_bench_xline: " << it->second->GetMask() << " matched " << (indexed ? indexed->mask : "nothing")
+						<< " indexed but " << (linear ? linear->mask : "nothing") << " checking every xline";
+			}
+		}
+		Log() << "m_bench_xline: " << checks << " checks, " << matched << " matched, " << mismatches << " mismatches";
+
+		/* Large lists no user matches, as when a blacklist has been imported */
+		for (int size = 1000; size <= 100000; size *= 10)
+		{
+			BenchXLineManager manager(this);
+			for (int k = 0; k < size; ++k)
+				manager.AddXLine(new XLine(BlacklistMask(k), "m_bench_xline"));
+
+			uint64_t start = Anope::MicroTime();
+			for (user_map::const_iterator it = UserListByNick.begin(), it_end = UserListByNick.end(); it != it_end; ++it)
+				manager.CheckAllXLines(it->second);
+			uint64_t indexed = Anope::MicroTime() - start;
+
+			/* Checking every xline is too slow to bother with for the largest list */
+			Anope::string linear = "not measured";
+			if (size <= 10000)
+			{
+				start = Anope::MicroTime();
+				for (user_map::const_iterator it = UserListByNick.begin(), it_end = UserListByNick.end(); it != it_end; ++it)
+					manager.CheckLinear(it->second);
+				linear = stringify((Anope::MicroTime() - start) / UserListByNick.size()) + "us per user";
+			}
+
+			Log() << "m_bench_xline: " << size << " xlines: indexed " << indexed / UserListByNick.size() << "us per user, checking every xline " << linear;
+		}
+	}
+};
+
+MODULE_INIT(BenchXLine)
@@ -0,0 +1,81 @@
+/*
+ *
+ * (C) 2003-2020 Anope Team
+ * Contact us at team@anope.org
+ *
+ * Please read COPYING and README for further details.
+ */
+
+/* Checks that cloning a channel as ChanServ CLONE does, by copying its
+ * ChannelInfo, and deleting the clone again leaves the settings and badwords
+ * of the original alone. The channels are registered for as long as this
+ * runs. This runs when the module is loaded and logs the results, eg:
+ *
+ *   /msg OperServ MODLOAD m_check_clone
+ */
+
+#include "module.h"
+#include "modules/bs_badwords.h"
+
+class CheckClone : public Module
+{
+	unsigned failures;
+
+	void Expect(bool ok, const Anope::string &what)
+	{
+		if (!ok)
+		{
+			++this->failures;
+			Log() << "m_check_clone: " << what;
+		}
+	}
+
+	/* Whether a channel has the setting and badword it was given */
+	bool Intact(ChannelInfo *ci)
+	{
+		BadWords *badwords = ci->GetExt<BadWords>("badwords");
+		return ci->HasExt("RESTRICTED") && badwords && badwords->GetBadWordCount() == 1 && badwords->GetBadWord(0)->word == "m_check_clone";
+	}
+
+ public:
+	CheckClone(const Anope::string &modname, const Anope::string &creator) : Module(modname, creator, EXTRA | VENDOR), failures(0)
+	{
+		static const Anope::string channel = "#m_check_clone", target = "#m_check_clone_target";
+
+		if (!ModuleManager::FindModule("bs_badwords") || !ModuleManager::FindModule("cs_set"))
+			throw ModuleException("bs_badwords and cs_set must be loaded");
+		if (ChannelInfo::Find(channel) || ChannelInfo::Find(target))
+			throw ModuleException(channel + " or " + target + " is registered");
+
+		ChannelInfo *ci = new ChannelInfo(channel);
+		ci->Extend<bool>("RESTRICTED");
+		ci->Require<BadWords>("badwords")->AddBadWord("m_check_clone", BW_ANY);
+
+		/* As ChanServ CLONE does */
+		ChannelInfo *target_ci = new ChannelInfo(*ci);
+		target_ci->name = target;
+		(*RegisteredChannelList)[target_ci->name] = target_ci;
+
+		this->Expect(!target_ci->HasExt("RESTRICTED") && !target_ci->HasExt("badwords"), "the clone has the extension items of the original");
+
+		target_ci->Extend<bool>("RESTRICTED");
+		BadWords *target_badwords = target_ci->Require<BadWords>("badwords");
+		this->Expect(target_badwords != ci->GetExt<BadWords>("badwords"), "the clone shares its badwords with the original");
+		target_badwords->ClearBadWords();
+		target_badwords->AddBadWord("m_check_clone", BW_ANY);
+
+		this->Expect(this->Intact(target_ci), "the clone does not have the setting and badword copied to it");
+		this->Expect(this->Intact(ci), "copying the setting and badword to the clone changed the original");
+
+		delete target_ci;
+		this->Expect(this->Intact(ci), "deleting the clone changed the original");
+		this->Expect(ChannelInfo::Find(channel) == ci, "deleting the clone unregistered the original");
+
+		ci->Require<BadWords>("badwords")->ClearBadWords();
+		delete ci;
+
+		Log() << "m_check_clone: " << this->failures << " failures";
+	}
+};
+
+MODULE_INIT(CheckClone)
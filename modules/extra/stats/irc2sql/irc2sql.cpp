@@ -59,7 +59,7 @@ void IRC2SQL::OnReload(Configuration::Conf *conf)
 			this->OnUserConnect(u, exempt);
 			for (User::ChanUserList::const_iterator cit = u->chans.begin(), cit_end = u->chans.end(); cit != cit_end; ++cit)
 			{
-				this->OnJoinChannel(u, cit->second->chan);
+				this->OnJoinChannel(u, (*cit)->chan);
 			}
 		}
 	}
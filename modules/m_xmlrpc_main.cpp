@@ -185,7 +185,7 @@ class MyXMLRPCEvent : public XMLRPCEvent
 			Anope::string users;
 			for (Channel::ChanUserList::const_iterator it = c->users.begin(); it != c->users.end(); ++it)
 			{
-				ChanUserContainer *uc = it->second;
+				ChanUserContainer *uc = *it;
 				users += uc->status.BuildModePrefixList() + uc->user->nick + " ";
 			}
 			if (!users.empty())
@@ -236,7 +236,7 @@ class MyXMLRPCEvent : public XMLRPCEvent
 			Anope::string channels;
 			for (User::ChanUserList::const_iterator it = u->chans.begin(); it != u->chans.end(); ++it)
 			{
-				ChanUserContainer *cc = it->second;
+				ChanUserContainer *cc = *it;
 				channels += cc->status.BuildModePrefixList() + cc->chan->name + " ";
 			}
 			if (!channels.empty())
@@ -56,15 +56,8 @@ class BotServCore : public Module
 		BotInfo *bi = user->server == Me ? dynamic_cast<BotInfo *>(user) : NULL;
 		if (bi && Config->GetModule(this)->Get<bool>("smartjoin"))
 		{
-			std::vector<Anope::string> bans = c->GetModeList("BAN");
-
 			/* We check for bans */
-			for (unsigned int i = 0; i < bans.size(); ++i)
-			{
-				Entry ban("BAN", bans[i]);
-				if (ban.Matches(user))
-					c->RemoveMode(NULL, "BAN", ban.GetMask());
-			}
+			c->Unban(user, "BAN");
 
 			Anope::string Limit;
 			unsigned limit = 0;
@@ -318,7 +318,7 @@ class ChanServCore : public Module, public ChanServService
 	void OnChannelSync(Channel *c) anope_override
 	{
 		bool perm = c->HasMode("PERM") || (c->ci && persist && persist->HasExt(c->ci));
-		if (!perm && !c->botchannel && (c->users.empty() || (c->users.size() == 1 && c->users.begin()->second->user->server == Me)))
+		if (!perm && !c->botchannel && (c->users.empty() || (c->users.size() == 1 && c->users.front()->user->server == Me)))
 		{
 			this->Hold(c);
 		}
@@ -350,7 +350,7 @@ class ChanServCore : public Module, public ChanServService
 				{
 					time_t last_used = ci->last_used;
 					for (Channel::ChanUserList::const_iterator cit = ci->c->users.begin(), cit_end = ci->c->users.end(); cit != cit_end && last_used == ci->last_used; ++cit)
-						ci->AccessFor(cit->second->user);
+						ci->AccessFor((*cit)->user);
 					expire = last_used == ci->last_used;
 				}
 				else
@@ -96,7 +96,7 @@ class MemoServCore : public Module, public MemoServService
 			{
 				for (Channel::ChanUserList::iterator it = ci->c->users.begin(), it_end = ci->c->users.end(); it != it_end; ++it)
 				{
-					ChanUserContainer *cu = it->second;
+					ChanUserContainer *cu = *it;
 
 					if (ci->AccessFor(cu->user).HasPriv("MEMO"))
 					{
@@ -343,7 +343,7 @@ class NickServCore : public Module, public NickServService
 
 			for (User::ChanUserList::iterator it = u->chans.begin(), it_end = u->chans.end(); it != it_end; ++it)
 			{
-				ChanUserContainer *cc = it->second;
+				ChanUserContainer *cc = *it;
 				Channel *c = cc->chan;
 				if (c)
 					c->SetCorrectModes(u, true);
@@ -384,7 +384,7 @@ class NickServCore : public Module, public NickServService
 	{
 		for (User::ChanUserList::iterator it = u->chans.begin(), it_end = u->chans.end(); it != it_end; ++it)
 		{
-			ChanUserContainer *cc = it->second;
+			ChanUserContainer *cc = *it;
 			Channel *c = cc->chan;
 			if (c)
 				c->SetCorrectModes(u, true);
@@ -44,23 +44,37 @@ class SGLineManager : public XLineManager
 			return x->regex->Matches(uh) || x->regex->Matches(nuhr);
 		}
 
-		if (!x->GetNick().empty() && !Anope::Match(u->nick, x->GetNick()))
+		if (!x->GetNick().empty() && !x->GetNickGlob().Matches(u->nick))
 			return false;
 
-		if (!x->GetUser().empty() && !Anope::Match(u->GetIdent(), x->GetUser()))
+		if (!x->GetUser().empty() && !x->GetUserGlob().Matches(u->GetIdent()))
 			return false;
 
-		if (!x->GetReal().empty() && !Anope::Match(u->realname, x->GetReal()))
+		if (!x->GetReal().empty() && !x->GetRealGlob().Matches(u->realname))
 			return false;
 
 		if (x->c && x->c->match(u->ip))
 			return true;
 
-		if (x->GetHost().empty() || Anope::Match(u->host, x->GetHost()) || Anope::Match(u->ip.addr(), x->GetHost()))
+		if (x->GetHost().empty() || x->GetHostGlob().Matches(u->host) || x->GetHostGlob().Matches(u->ip.addr()))
 			return true;
 
 		return false;
 	}
+
+	bool GetIndexMask(const XLine *x, Anope::string &mask) anope_override
+	{
+		if (x->regex || x->GetHost().empty())
+			return false;
+		mask = x->GetHost();
+		return true;
+	}
+
+	void GetIndexKeys(User *u, std::vector<Anope::string> &keys) anope_override
+	{
+		keys.push_back(u->host);
+		keys.push_back(u->ip.addr());
+	}
 };
 
 class SQLineManager : public XLineManager
@@ -117,7 +131,20 @@ class SQLineManager : public XLineManager
 	{
 		if (x->regex)
 			return x->regex->Matches(u->nick);
-		return Anope::Match(u->nick, x->mask);
+		return x->GetMaskGlob().Matches(u->nick);
+	}
+
+	bool GetIndexMask(const XLine *x, Anope::string &mask) anope_override
+	{
+		if (x->regex)
+			return false;
+		mask = x->mask;
+		return true;
+	}
+
+	void GetIndexKeys(User *u, std::vector<Anope::string> &keys) anope_override
+	{
+		keys.push_back(u->nick);
 	}
 
 	XLine *CheckChannel(Channel *c)
@@ -136,7 +163,7 @@ class SQLineManager : public XLineManager
 				if (x->mask.empty() || x->mask[0] != '#')
 					continue;
 
-				if (Anope::Match(c->name, x->mask, false, true))
+				if (x->GetMaskGlob().Matches(c->name))
 					return x;
 			}
 		}
@@ -178,7 +205,22 @@ class SNLineManager : public XLineManager
 	{
 		if (x->regex)
 			return x->regex->Matches(u->realname);
-		return Anope::Match(u->realname, x->mask, false, true);
+		else if (x->IsRegex())
+			return Anope::Match(u->realname, x->mask, false, true);
+		return x->GetMaskGlob().Matches(u->realname);
+	}
+
+	bool GetIndexMask(const XLine *x, Anope::string &mask) anope_override
+	{
+		if (x->IsRegex())
+			return false;
+		mask = x->mask;
+		return true;
+	}
+
+	void GetIndexKeys(User *u, std::vector<Anope::string> &keys) anope_override
+	{
+		keys.push_back(u->realname);
 	}
 };
 
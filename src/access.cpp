@@ -174,6 +174,7 @@ void ChanAccess::SetMask(const Anope::string &m, ChannelInfo *c)
 
 	ci = c;
 	mask.clear();
+	glob.Compile("");
 	nc = NULL;
 
 	const NickAlias *na = NickAlias::Find(m);
@@ -185,6 +186,7 @@ void ChanAccess::SetMask(const Anope::string &m, ChannelInfo *c)
 	else
 	{
 		mask = m;
+		glob.Compile(m);
 
 		ChannelInfo *targci = ChannelInfo::Find(mask);
 		if (targci != NULL)
@@ -260,9 +262,9 @@ bool ChanAccess::Matches(const User *u, const NickCore *acc, ChannelInfo* &next)
 	if (u)
 	{
 		bool is_mask = this->mask.find_first_of("!@?*") != Anope::string::npos;
-		if (is_mask && Anope::Match(u->nick, this->mask))
+		if (is_mask && this->glob.Matches(u->nick))
 			return true;
-		else if (Anope::Match(u->GetDisplayedMask(), this->mask))
+		else if (this->glob.Matches(u->GetDisplayedMask()))
 			return true;
 	}
 
@@ -271,7 +273,7 @@ bool ChanAccess::Matches(const User *u, const NickCore *acc, ChannelInfo* &next)
 		for (unsigned i = 0; i < acc->aliases->size(); ++i)
 		{
 			const NickAlias *na = acc->aliases->at(i);
-			if (Anope::Match(na->nick, this->mask))
+			if (this->glob.Matches(na->nick))
 				return true;
 		}
 	}
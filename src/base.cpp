@@ -10,8 +10,9 @@
 #include "anope.h"
 #include "service.h"
 
-std::map<Anope::string, std::map<Anope::string, Service *> > Service::Services;
-std::map<Anope::string, std::map<Anope::string, Anope::string> > Service::Aliases;
+TR1NS::unordered_map<Anope::string, Service::ServiceMap, Anope::hash_cs> Service::Services;
+TR1NS::unordered_map<Anope::string, Service::AliasMap, Anope::hash_cs> Service::Aliases;
+unsigned Service::Generation = 0;
 
 Base::Base() : references(NULL)
 {
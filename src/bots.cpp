@@ -132,7 +132,7 @@ void BotInfo::OnKill()
 	this->introduced = true;
 
 	for (User::ChanUserList::const_iterator cit = this->chans.begin(), cit_end = this->chans.end(); cit != cit_end; ++cit)
-		IRCD->SendJoin(this, cit->second->chan, &cit->second->status);
+		IRCD->SendJoin(this, (*cit)->chan, &(*cit)->status);
 }
 
 void BotInfo::SetNewNick(const Anope::string &newnick)
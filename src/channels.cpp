@@ -65,15 +65,25 @@ Channel::~Channel()
 		this->ci->c = NULL;
 
 	ChannelList.erase(this->name);
+
+	this->ClearListMatchers();
+}
+
+void Channel::ClearListMatchers()
+{
+	for (std::map<Anope::string, ListModeMatcher *>::iterator it = this->list_matchers.begin(), it_end = this->list_matchers.end(); it != it_end; ++it)
+		delete it->second;
+	this->list_matchers.clear();
 }
 
 void Channel::Reset()
 {
 	this->modes.clear();
+	this->ClearListMatchers();
 
 	for (ChanUserList::const_iterator it = this->users.begin(), it_end = this->users.end(); it != it_end; ++it)
 	{
-		ChanUserContainer *uc = it->second;
+		ChanUserContainer *uc = *it;
 
 		ChannelStatus f = uc->status;
 		uc->status.Clear();
@@ -89,7 +99,7 @@ void Channel::Reset()
 	}
 
 	for (ChanUserList::const_iterator it = this->users.begin(), it_end = this->users.end(); it != it_end; ++it)
-		this->SetCorrectModes(it->second->user, true);
+		this->SetCorrectModes((*it)->user, true);
 
 	// If the channel is syncing now, do not force a sync due to Reset(), as we are probably iterating over users in Message::SJoin
 	// A sync will come soon
@@ -139,14 +149,70 @@ bool Channel::CheckDelete()
 	return MOD_RESULT != EVENT_STOP && this->users.empty();
 }
 
+/* Every membership, hashed by user and channel. The containers are chained
+ * through their own hash_next links, so the index allocates nothing per
+ * membership. The number of buckets is a power of two which is grown to
+ * keep it at least the number of memberships.
+ */
+static std::vector<ChanUserContainer *> membership_buckets(1024);
+static size_t membership_count = 0;
+
+static inline size_t MembershipBucket(const User *u, const Channel *c)
+{
+	size_t h = reinterpret_cast<size_t>(u) ^ (reinterpret_cast<size_t>(c) * 2654435761U);
+	h ^= h >> 15;
+	h *= 2246822519U;
+	h ^= h >> 13;
+	return h & (membership_buckets.size() - 1);
+}
+
+static void IndexMembership(ChanUserContainer *cuc)
+{
+	if (++membership_count > membership_buckets.size())
+	{
+		std::vector<ChanUserContainer *> old(membership_buckets.size() * 2);
+		old.swap(membership_buckets);
+
+		for (unsigned i = 0; i < old.size(); ++i)
+			for (ChanUserContainer *c = old[i], *next; c; c = next)
+			{
+				next = c->hash_next;
+				ChanUserContainer *&bucket = membership_buckets[MembershipBucket(c->user, c->chan)];
+				c->hash_next = bucket;
+				bucket = c;
+			}
+	}
+
+	ChanUserContainer *&bucket = membership_buckets[MembershipBucket(cuc->user, cuc->chan)];
+	cuc->hash_next = bucket;
+	bucket = cuc;
+}
+
+static void UnindexMembership(ChanUserContainer *cuc)
+{
+	for (ChanUserContainer **c = &membership_buckets[MembershipBucket(cuc->user, cuc->chan)]; *c; c = &(*c)->hash_next)
+		if (*c == cuc)
+		{
+			*c = cuc->hash_next;
+			cuc->hash_next = NULL;
+			--membership_count;
+			return;
+		}
+}
+
 ChanUserContainer* Channel::JoinUser(User *user, const ChannelStatus *status)
 {
 	if (user->server && user->server->IsSynced())
 		Log(user, this, "join");
 
-	ChanUserContainer *cuc = new ChanUserContainer(user, this);
-	user->chans[this] = cuc;
-	this->users[user] = cuc;
+	ChanUserContainer *cuc = this->FindUser(user);
+	if (!cuc)
+	{
+		cuc = new ChanUserContainer(user, this);
+		user->chans.push_back(cuc);
+		this->users.push_back(cuc);
+		IndexMembership(cuc);
+	}
 	if (status)
 		cuc->status = *status;
 
@@ -160,29 +226,31 @@ void Channel::DeleteUser(User *user)
 
 	FOREACH_MOD(OnLeaveChannel, (user, this));
 
-	ChanUserContainer *cu = user->FindChannel(this);
-	if (!this->users.erase(user))
+	ChanUserContainer *cu = this->FindUser(user);
+	if (cu)
+	{
+		UnindexMembership(cu);
+		this->users.erase(cu);
+		user->chans.erase(cu);
+		delete cu;
+	}
+	else
 		Log(LOG_DEBUG) << "Channel::DeleteUser() tried to delete nonexistent user " << user->nick << " from channel " << this->name;
 
-	if (!user->chans.erase(this))
-		Log(LOG_DEBUG) << "Channel::DeleteUser() tried to delete nonexistent channel " << this->name << " from " << user->nick << "'s channel list";
-	delete cu;
-
 	QueueForDeletion();
 }
 
 ChanUserContainer *Channel::FindUser(User *u) const
 {
-	ChanUserList::const_iterator it = this->users.find(u);
-	if (it != this->users.end())
-		return it->second;
+	for (ChanUserContainer *cuc = membership_buckets[MembershipBucket(u, this)]; cuc; cuc = cuc->hash_next)
+		if (cuc->user == u && cuc->chan == this)
+			return cuc;
 	return NULL;
 }
 
 bool Channel::HasUserStatus(User *u, ChannelModeStatus *cms)
 {
-	/* Usually its more efficient to search the users channels than the channels users */
-	ChanUserContainer *cc = u->FindChannel(this);
+	ChanUserContainer *cc = this->FindUser(u);
 	if (cc)
 	{
 		if (cms)
@@ -306,6 +374,14 @@ void Channel::SetModeInternal(MessageSource &setter, ChannelMode *ocm, const Ano
 
 	this->modes.insert(std::make_pair(cm->name, param));
 
+	if (cm->type == MODE_LIST)
+	{
+		ListModeMatcher *&matcher = this->list_matchers[cm->name];
+		if (!matcher)
+			matcher = new ListModeMatcher(cm->name);
+		matcher->Add(param);
+	}
+
 	if (param.empty() && cm->type != MODE_REGULAR)
 	{
 		Log() << "Channel::SetModeInternal() mode " << cm->mchar << " for " << this->name << " with no paramater, but is a param mode";
@@ -378,6 +454,17 @@ void Channel::RemoveModeInternal(MessageSource &setter, ChannelMode *ocm, const
 				this->modes.erase(it);
 				break;
 			}
+
+		std::map<Anope::string, ListModeMatcher *>::iterator it = this->list_matchers.find(cm->name);
+		if (it != this->list_matchers.end())
+		{
+			it->second->Del(param);
+			if (it->second->empty())
+			{
+				delete it->second;
+				this->list_matchers.erase(it);
+			}
+		}
 	}
 	else
 		this->modes.erase(cm->name);
@@ -725,18 +812,16 @@ void Channel::SetModesInternal(MessageSource &source, const Anope::string &mode,
 
 bool Channel::MatchesList(User *u, const Anope::string &mode)
 {
-	if (!this->HasMode(mode))
-		return false;
-
-	std::vector<Anope::string> v = this->GetModeList(mode);
-	for (unsigned i = 0; i < v.size(); ++i)
-	{
-		Entry e(mode, v[i]);
-		if (e.Matches(u))
-			return true;
-	}
+	const ListModeMatcher *matcher = this->GetListMatcher(mode);
+	return matcher && matcher->Matches(u);
+}
 
-	return false;
+const ListModeMatcher *Channel::GetListMatcher(const Anope::string &mode) const
+{
+	std::map<Anope::string, ListModeMatcher *>::const_iterator it = this->list_matchers.find(mode);
+	if (it != this->list_matchers.end())
+		return it->second;
+	return NULL;
 }
 
 void Channel::KickInternal(const MessageSource &source, const Anope::string &nick, const Anope::string &reason)
@@ -875,23 +960,16 @@ void Channel::SetCorrectModes(User *user, bool give_modes)
 
 bool Channel::Unban(User *u, const Anope::string &mode, bool full)
 {
-	if (!this->HasMode(mode))
+	const ListModeMatcher *matcher = this->GetListMatcher(mode);
+	if (!matcher)
 		return false;
 
-	bool ret = false;
-
-	std::vector<Anope::string> v = this->GetModeList(mode);
+	std::vector<Anope::string> v;
+	matcher->GetMatches(u, full, v);
 	for (unsigned int i = 0; i < v.size(); ++i)
-	{
-		Entry ban(mode, v[i]);
-		if (ban.Matches(u, full))
-		{
-			this->RemoveMode(NULL, mode, ban.GetMask());
-			ret = true;
-		}
-	}
+		this->RemoveMode(NULL, mode, v[i]);
 
-	return ret;
+	return !v.empty();
 }
 
 bool Channel::CheckKick(User *user)
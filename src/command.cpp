@@ -10,6 +10,7 @@
 #include "commands.h"
 #include "users.h"
 #include "language.h"
+#include "watchdog.h"
 #include "config.h"
 #include "bots.h"
 #include "opertype.h"
@@ -284,6 +285,7 @@ void Command::Run(CommandSource &source, const Anope::string &cmdname, const Com
 		return;
 	}
 
+	Watchdog::Context context("command", this->name);
 	this->Execute(source, params);
 	FOREACH_MOD(OnPostCommand, (source, this, params));
 }
@@ -196,6 +196,9 @@ Conf::Conf() : Block("")
 	}
 	this->DefLanguage = options->Get<const Anope::string>("defaultlanguage");
 	this->TimeoutCheck = options->Get<time_t>("timeoutcheck");
+	this->UplinkFlushSize = options->Get<unsigned>("uplinkflushsize", "65536");
+	this->SlowHookThreshold = options->Get<unsigned>("slowhookthreshold");
+	this->StallThreshold = options->Get<unsigned>("stallthreshold");
 	this->NickChars = networkinfo->Get<Anope::string>("nick_chars");
 
 	for (int i = 0; i < this->CountBlock("uplink"); ++i)
@@ -538,6 +541,9 @@ Conf::Conf() : Block("")
 	}
 	Anope::CaseMapRebuild();
 
+	ModuleManager::ProfileHooks = options->Get<bool>("profilehooks");
+	Anope::FlushRegexCache();
+
 	/* Check the user keys */
 	if (!options->Get<unsigned>("seed"))
 		Log() << "Configuration option options:seed should be set. It's for YOUR safety! Remember that!";
@@ -20,6 +20,41 @@ ExtensibleBase::~ExtensibleBase()
 	extensible_items.erase(this);
 }
 
+const ExtensibleEntry *ExtensibleBase::Find(const Extensible *obj) const
+{
+	const std::vector<ExtensibleEntry> &entries = obj->extension_items;
+	for (unsigned i = 0; i < entries.size(); ++i)
+		if (entries[i].item == this)
+			return &entries[i];
+	return NULL;
+}
+
+void ExtensibleBase::Add(Extensible *obj, void *value)
+{
+	ExtensibleEntry entry = { this, value, this->objects.size() };
+	obj->extension_items.push_back(entry);
+	this->objects.push_back(obj);
+}
+
+void *ExtensibleBase::Remove(Extensible *obj)
+{
+	std::vector<ExtensibleEntry> &entries = obj->extension_items;
+	ExtensibleEntry *entry = const_cast<ExtensibleEntry *>(this->Find(obj));
+	ExtensibleEntry removed = *entry;
+
+	*entry = entries.back();
+	entries.pop_back();
+
+	/* Move the last object into the removed one's place, and tell it where it went */
+	Extensible *last = this->objects.back();
+	this->objects[removed.index] = last;
+	this->objects.pop_back();
+	if (last != obj)
+		const_cast<ExtensibleEntry *>(this->Find(last))->index = removed.index;
+
+	return removed.value;
+}
+
 Extensible::~Extensible()
 {
 	UnsetExtensibles();
@@ -28,7 +63,7 @@ Extensible::~Extensible()
 void Extensible::UnsetExtensibles()
 {
 	while (!extension_items.empty())
-		(*extension_items.begin())->Unset(this);
+		extension_items.back().item->Unset(this);
 }
 
 bool Extensible::HasExt(const Anope::string &name) const
@@ -43,11 +78,8 @@ bool Extensible::HasExt(const Anope::string &name) const
 
 void Extensible::ExtensibleSerialize(const Extensible *e, const Serializable *s, Serialize::Data &data)
 {
-	for (std::set<ExtensibleBase *>::iterator it = e->extension_items.begin(); it != e->extension_items.end(); ++it)
-	{
-		ExtensibleBase *eb = *it;
-		eb->ExtensibleSerialize(e, s, data);
-	}
+	for (unsigned i = 0; i < e->extension_items.size(); ++i)
+		e->extension_items[i].item->ExtensibleSerialize(e, s, data);
 }
 
 void Extensible::ExtensibleUnserialize(Extensible *e, Serializable *s, Serialize::Data &data)
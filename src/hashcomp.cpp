@@ -13,7 +13,7 @@
 /* Case map in use by Anope */
 std::locale Anope::casemap = std::locale(std::locale(), new Anope::ascii_ctype<char>());
 /* Cache of the above case map, forced upper */
-static unsigned char case_map_upper[256], case_map_lower[256];
+unsigned char Anope::case_map_upper[256], Anope::case_map_lower[256];
 
 /* called whenever Anope::casemap is modified to rebuild the casemap cache */
 void Anope::CaseMapRebuild()
@@ -27,15 +27,7 @@ void Anope::CaseMapRebuild()
 	}
 }
 
-unsigned char Anope::tolower(unsigned char c)
-{
-	return case_map_lower[c];
-}
-
-unsigned char Anope::toupper(unsigned char c)
-{
-	return case_map_upper[c];
-}
+using Anope::case_map_upper;
 
 /*
  *
@@ -86,9 +78,44 @@ const char *ci::ci_char_traits::find(const char *s1, int n, char c)
 	return n >= 0 ? s1 : NULL;
 }
 
+int ci::compare(const char *str1, size_t len1, const char *str2, size_t len2)
+{
+	int r = ci_char_traits::compare(str1, str2, std::min(len1, len2));
+	if (r)
+		return r;
+	return len1 < len2 ? -1 : (len1 > len2 ? 1 : 0);
+}
+
+bool ci::equals(const char *str1, size_t len1, const char *str2, size_t len2)
+{
+	if (len1 != len2)
+		return false;
+
+	/* Strings which are compared are usually in the same case already */
+	if (!memcmp(str1, str2, len1))
+		return true;
+
+	for (size_t i = 0; i < len1; ++i)
+		if (case_map_upper[static_cast<unsigned char>(str1[i])] != case_map_upper[static_cast<unsigned char>(str2[i])])
+			return false;
+	return true;
+}
+
+size_t ci::hash(const char *str, size_t len)
+{
+	/* FNV-1a over the folded characters */
+	size_t h = 2166136261U;
+	for (size_t i = 0; i < len; ++i)
+	{
+		h ^= case_map_upper[static_cast<unsigned char>(str[i])];
+		h *= 16777619U;
+	}
+	return h;
+}
+
 bool ci::less::operator()(const Anope::string &s1, const Anope::string &s2) const
 {
-	return s1.ci_str().compare(s2.ci_str()) < 0;
+	return ci::compare(s1.c_str(), s1.length(), s2.c_str(), s2.length()) < 0;
 }
 
 sepstream::sepstream(const Anope::string &source, char seperator, bool ae) : tokens(source), sep(seperator), pos(0), allow_empty(ae)
@@ -15,6 +15,7 @@
 #include "bots.h"
 #include "socketengine.h"
 #include "uplink.h"
+#include "watchdog.h"
 
 #ifndef _WIN32
 #include <limits.h>
@@ -155,7 +156,6 @@ int main(int ac, char **av, char **envp)
 	}
 
 	/* Set up timers */
-	time_t last_check = Anope::CurTime;
 	UpdateTimer updateTimer(Config->GetBlock("options")->Get<time_t>("updatetimeout", "5m"));
 	ExpireTimer expireTimer(Config->GetBlock("options")->Get<time_t>("expiretimeout", "30m"));
 
@@ -164,20 +164,29 @@ int main(int ac, char **av, char **envp)
 	{
 		Log(LOG_DEBUG_2) << "Top of main loop";
 
+		Watchdog::Begin();
+
 		/* Process timers */
-		if (Anope::CurTime - last_check >= Config->TimeoutCheck)
-		{
-			TimerManager::TickTimers(Anope::CurTime);
-			last_check = Anope::CurTime;
-		}
+		TimerManager::TickTimers(Anope::CurTime);
+
+		/* Send everything queued for the uplink since the last flush */
+		if (UplinkSock)
+			UplinkSock->Flush();
+
+		/* Waiting for events is not a stall, the socket engine calls Begin() again once it is done waiting */
+		Watchdog::End();
 
 		/* Process the socket engine */
 		SocketEngine::Process();
 
 		if (Anope::Signal)
 			Anope::HandleSignal();
+
+		Watchdog::End();
 	}
 
+	Watchdog::Shutdown();
+
 	if (Anope::Restarting)
 	{
 		FOREACH_MOD(OnRestart, ());
@@ -80,7 +80,7 @@ void Join::Run(MessageSource &source, const std::vector<Anope::string> &params)
 		{
 			for (User::ChanUserList::iterator it = user->chans.begin(), it_end = user->chans.end(); it != it_end; )
 			{
-				ChanUserContainer *cc = it->second;
+				ChanUserContainer *cc = *it;
 				Channel *c = cc->chan;
 				++it;
 
@@ -24,6 +24,7 @@
 #include <sys/stat.h>
 #ifndef _WIN32
 #include <sys/socket.h>
+#include <sys/time.h>
 #include <netdb.h>
 #endif
 
@@ -403,40 +404,117 @@ Anope::string Anope::Expires(time_t expires, const NickCore *nc)
 	}
 }
 
-bool Anope::Match(const Anope::string &str, const Anope::string &mask, bool case_sensitive, bool use_regex)
+/* The most compiled regular expressions Match() keeps */
+static const size_t RegexCacheSize = 64;
+
+struct CachedRegex
 {
-	size_t s = 0, m = 0, str_len = str.length(), mask_len = mask.length();
+	Anope::string expression;
+	/* The provider which compiled this, the regex can only be deleted while it is still loaded */
+	RegexProvider *provider;
+	/* NULL if the expression is invalid */
+	Regex *regex;
+};
 
-	if (use_regex && mask_len >= 2 && mask[0] == '/' && mask[mask.length() - 1] == '/')
-	{
-		Anope::string stripped_mask = mask.substr(1, mask_len - 2);
-		// This is often called with the same mask multiple times in a row, so cache it
-		static Regex *r = NULL;
+/* Most recently used first */
+typedef std::list<CachedRegex> RegexCacheList;
+static RegexCacheList regex_cache;
+static TR1NS::unordered_map<Anope::string, RegexCacheList::iterator, Anope::hash_cs> regex_cache_index;
+/* The configuration and services the cache was filled with */
+static Configuration::Conf *regex_cache_config = NULL;
+static size_t regex_cache_generation = 0;
+static Anope::string regex_cache_engine;
+static uint64_t regex_cache_hits = 0, regex_cache_misses = 0;
+
+static void EraseCachedRegex(RegexCacheList::iterator it)
+{
+	/* If the provider has gone away so has the code to delete the regex */
+	if (it->regex && Service::FindService("Regex", regex_cache_engine) == it->provider)
+		delete it->regex;
+	regex_cache_index.erase(it->expression);
+	regex_cache.erase(it);
+}
 
-		if (r == NULL || r->GetExpression() != stripped_mask)
+void Anope::FlushRegexCache()
+{
+	while (!regex_cache.empty())
+		EraseCachedRegex(regex_cache.begin());
+	regex_cache_config = NULL;
+}
+
+void Anope::GetRegexCacheStats(size_t &entries, uint64_t &hits, uint64_t &misses)
+{
+	entries = regex_cache.size();
+	hits = regex_cache_hits;
+	misses = regex_cache_misses;
+}
+
+static Regex *GetRegex(const Anope::string &expression)
+{
+	if (regex_cache_config != Config)
+	{
+		Anope::FlushRegexCache();
+		regex_cache_config = Config;
+		regex_cache_engine = Config->GetBlock("options")->Get<const Anope::string>("regexengine");
+		regex_cache_generation = Service::GetGeneration();
+	}
+	else if (regex_cache_generation != Service::GetGeneration())
+	{
+		/* Forget the regexes of providers which have been unloaded */
+		for (RegexCacheList::iterator it = regex_cache.begin(); it != regex_cache.end();)
 		{
-			ServiceReference<RegexProvider> provider("Regex", Config->GetBlock("options")->Get<const Anope::string>("regexengine"));
-			if (provider)
-			{
-				try
-				{
-					delete r;
-					r = NULL;
-					// This may throw
-					r = provider->Compile(stripped_mask);
-				}
-				catch (const RegexException &ex)
-				{
-					Log(LOG_DEBUG) << ex.GetReason();
-				}
-			}
-			else
+			RegexCacheList::iterator cur = it++;
+			if (Service::FindService("Regex", regex_cache_engine) != cur->provider)
 			{
-				delete r;
-				r = NULL;
+				cur->regex = NULL;
+				EraseCachedRegex(cur);
 			}
 		}
+		regex_cache_generation = Service::GetGeneration();
+	}
+
+	TR1NS::unordered_map<Anope::string, RegexCacheList::iterator, Anope::hash_cs>::iterator it = regex_cache_index.find(expression);
+	if (it != regex_cache_index.end())
+	{
+		++regex_cache_hits;
+		regex_cache.splice(regex_cache.begin(), regex_cache, it->second);
+		return it->second->regex;
+	}
 
+	++regex_cache_misses;
+
+	ServiceReference<RegexProvider> provider("Regex", regex_cache_engine);
+	if (!provider)
+		return NULL;
+
+	CachedRegex cr;
+	cr.expression = expression;
+	cr.provider = provider;
+	cr.regex = NULL;
+	try
+	{
+		cr.regex = provider->Compile(expression);
+	}
+	catch (const RegexException &ex)
+	{
+		Log(LOG_DEBUG) << ex.GetReason();
+	}
+
+	if (regex_cache.size() >= RegexCacheSize)
+		EraseCachedRegex(--regex_cache.end());
+
+	regex_cache.push_front(cr);
+	regex_cache_index[expression] = regex_cache.begin();
+	return cr.regex;
+}
+
+bool Anope::Match(const Anope::string &str, const Anope::string &mask, bool case_sensitive, bool use_regex)
+{
+	size_t s = 0, m = 0, str_len = str.length(), mask_len = mask.length();
+
+	if (use_regex && mask_len >= 2 && mask[0] == '/' && mask[mask.length() - 1] == '/')
+	{
+		Regex *r = GetRegex(mask.substr(1, mask_len - 2));
 		if (r != NULL && r->Matches(str))
 			return true;
 
@@ -501,7 +579,7 @@ bool Anope::Match(const Anope::string &str, const Anope::string &mask, bool case
 		}
 	}
 
-	if (m < mask_len && mask[m] == '*')
+	while (m < mask_len && mask[m] == '*')
 		++m;
 
 	return m == mask_len;
@@ -542,6 +620,133 @@ Anope::string Anope::printf(const char *fmt, ...)
 	return buf;
 }
 
+Anope::Glob::Glob() : case_sensitive(false), leading_star(false), trailing_star(false), min_length(0)
+{
+	segments.push_back("");
+}
+
+Anope::Glob::Glob(const Anope::string &m, bool cs)
+{
+	this->Compile(m, cs);
+}
+
+void Anope::Glob::Compile(const Anope::string &m, bool cs)
+{
+	this->mask = m;
+	this->case_sensitive = cs;
+	this->segments.clear();
+	this->min_length = 0;
+
+	/* Runs of '*' are the same as one, so only the text between them matters */
+	sepstream sep(m, '*');
+	Anope::string segment;
+	while (sep.GetToken(segment))
+	{
+		this->segments.push_back(segment);
+		this->min_length += segment.length();
+	}
+	if (this->segments.empty())
+		this->segments.push_back("");
+
+	this->leading_star = !m.empty() && m[0] == '*';
+	this->trailing_star = !m.empty() && m[m.length() - 1] == '*';
+}
+
+bool Anope::Glob::MatchSegment(const char *str, const Anope::string &segment) const
+{
+	for (size_t i = 0, len = segment.length(); i < len; ++i)
+	{
+		char wild = segment[i];
+		if (wild == '?')
+			continue;
+		if (this->case_sensitive ? wild != str[i] : Anope::tolower(wild) != Anope::tolower(str[i]))
+			return false;
+	}
+	return true;
+}
+
+size_t Anope::Glob::FindSegment(const char *str, size_t start, size_t end, const Anope::string &segment) const
+{
+	size_t len = segment.length();
+	if (!len)
+		return start;
+
+	char first = segment[0];
+	if (first == '?')
+	{
+		for (; start + len <= end; ++start)
+			if (this->MatchSegment(str + start, segment))
+				return start;
+		return Anope::string::npos;
+	}
+
+	if (!this->case_sensitive && Anope::tolower(first) != Anope::toupper(first))
+	{
+		unsigned char lower = Anope::tolower(first);
+		for (; start + len <= end; ++start)
+			if (Anope::tolower(str[start]) == lower && this->MatchSegment(str + start, segment))
+				return start;
+		return Anope::string::npos;
+	}
+
+	/* The first character of the segment can be searched for directly, which memchr does quickly */
+	while (start + len <= end)
+	{
+		const char *p = static_cast<const char *>(memchr(str + start, first, end - len + 1 - start));
+		if (!p)
+			break;
+		start = p - str;
+		if (this->MatchSegment(p, segment))
+			return start;
+		++start;
+	}
+	return Anope::string::npos;
+}
+
+bool Anope::Glob::Matches(const Anope::string &str) const
+{
+	size_t len = str.length();
+	if (len < this->min_length)
+		return false;
+
+	const char *s = str.c_str();
+	const Anope::string &first = this->segments.front(), &last = this->segments.back();
+
+	/* No '*', so the whole string must match the only segment */
+	if (!this->leading_star && !this->trailing_star && this->segments.size() == 1)
+		return len == first.length() && this->MatchSegment(s, first);
+
+	size_t start = 0, end = len, i = 0, count = this->segments.size();
+
+	if (!this->leading_star)
+	{
+		if (!this->MatchSegment(s, first))
+			return false;
+		start = first.length();
+		++i;
+	}
+
+	if (!this->trailing_star && i < count)
+	{
+		if (!this->MatchSegment(s + len - last.length(), last))
+			return false;
+		end = len - last.length();
+		--count;
+	}
+
+	/* Each remaining segment is matched at the first place it fits, which is enough as they are separated by '*' */
+	for (; i < count; ++i)
+	{
+		const Anope::string &segment = this->segments[i];
+		size_t pos = this->FindSegment(s, start, end, segment);
+		if (pos == Anope::string::npos)
+			return false;
+		start = pos + segment.length();
+	}
+
+	return start <= end;
+}
+
 Anope::string Anope::Hex(const Anope::string &data)
 {
 	const char hextable[] = "0123456789abcdef";
@@ -593,6 +798,48 @@ void Anope::Unhex(const Anope::string &src, char *dest, size_t sz)
 	memcpy(dest, d.c_str(), std::min(d.length() + 1, sz));
 }
 
+Anope::InternedString::Pool Anope::InternedString::pool;
+
+Anope::InternedString::Entry *Anope::InternedString::Acquire(const Anope::string &str)
+{
+	if (str.empty())
+		return NULL;
+
+	Entry &e = *pool.insert(std::make_pair(str, 0U)).first;
+	++e.second;
+	return &e;
+}
+
+void Anope::InternedString::Release(Entry *e)
+{
+	if (e && !--e->second)
+		pool.erase(e->first);
+}
+
+const Anope::string &Anope::InternedString::get() const
+{
+	static const Anope::string empty_string;
+	return entry ? entry->first : empty_string;
+}
+
+void Anope::InternedString::GetStats(size_t &strings, size_t &references, size_t &saved)
+{
+	strings = pool.size();
+	references = saved = 0;
+	for (Pool::const_iterator it = pool.begin(), it_end = pool.end(); it != it_end; ++it)
+	{
+		references += it->second;
+		saved += (it->second - 1) * it->first.length();
+	}
+}
+
+uint64_t Anope::MicroTime()
+{
+	timeval tv;
+	gettimeofday(&tv, NULL);
+	return static_cast<uint64_t>(tv.tv_sec) * 1000000 + tv.tv_usec;
+}
+
 int Anope::LastErrorCode()
 {
 #ifndef _WIN32
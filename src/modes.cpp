@@ -894,3 +894,136 @@ bool Entry::Matches(User *u, bool full) const
 
 	return ret;
 }
+
+ListModeMatcher::ListModeMatcher(const Anope::string &m) : mode(m)
+{
+}
+
+ListModeMatcher::~ListModeMatcher()
+{
+	for (Anope::hash_map<Entry *>::const_iterator it = entries.begin(), it_end = entries.end(); it != it_end; ++it)
+		delete it->second;
+}
+
+void ListModeMatcher::Add(const Anope::string &mask)
+{
+	Entry *&e = entries[mask];
+	if (e)
+		return;
+	e = new Entry(this->mode, mask);
+
+	if (IRCD && IRCD->IsExtbanValid(mask))
+		wild.push_back(e);
+	else if (e->cidr_len)
+	{
+		ranges.insert(sockaddrs(e->host), e->cidr_len, e);
+		/* The host of a CIDR entry is also matched as text when the user's IP can not be used */
+		hosts[e->host].push_back(e);
+	}
+	else if (!e->host.empty() && e->host.find_first_of("*?") == Anope::string::npos)
+		hosts[e->host].push_back(e);
+	else if (!e->nick.empty() && e->nick.find_first_of("*?") == Anope::string::npos)
+		nicks[e->nick].push_back(e);
+	else
+		wild.push_back(e);
+}
+
+static void EraseEntry(std::vector<Entry *> &v, Entry *e)
+{
+	std::vector<Entry *>::iterator it = std::find(v.begin(), v.end(), e);
+	if (it != v.end())
+	{
+		*it = v.back();
+		v.pop_back();
+	}
+}
+
+void ListModeMatcher::Del(const Anope::string &mask)
+{
+	Anope::hash_map<Entry *>::iterator it = entries.find(mask);
+	if (it == entries.end())
+		return;
+	Entry *e = it->second;
+	entries.erase(it);
+
+	if (e->cidr_len)
+		ranges.erase(sockaddrs(e->host), e->cidr_len, e);
+
+	Anope::hash_map<std::vector<Entry *> >::iterator hit = hosts.find(e->host);
+	if (hit != hosts.end())
+	{
+		EraseEntry(hit->second, e);
+		if (hit->second.empty())
+			hosts.erase(hit);
+	}
+
+	hit = nicks.find(e->nick);
+	if (hit != nicks.end())
+	{
+		EraseEntry(hit->second, e);
+		if (hit->second.empty())
+			nicks.erase(hit);
+	}
+
+	EraseEntry(wild, e);
+	delete e;
+}
+
+void ListModeMatcher::GetCandidates(User *u, std::vector<Entry *> &candidates) const
+{
+	if (!hosts.empty())
+	{
+		const Anope::string *user_hosts[] = { &u->GetDisplayedHost(), &u->GetCloakedHost(), &u->host.get() };
+		for (unsigned i = 0; i < sizeof(user_hosts) / sizeof(*user_hosts); ++i)
+		{
+			Anope::hash_map<std::vector<Entry *> >::const_iterator it = hosts.find(*user_hosts[i]);
+			if (it != hosts.end())
+				candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+		}
+
+		if (u->ip.valid())
+		{
+			Anope::hash_map<std::vector<Entry *> >::const_iterator it = hosts.find(u->ip.addr());
+			if (it != hosts.end())
+				candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+		}
+	}
+
+	if (!ranges.empty() && u->ip.valid())
+		ranges.find(u->ip, candidates);
+
+	if (!nicks.empty())
+	{
+		Anope::hash_map<std::vector<Entry *> >::const_iterator it = nicks.find(u->nick);
+		if (it != nicks.end())
+			candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+	}
+
+	candidates.insert(candidates.end(), wild.begin(), wild.end());
+}
+
+bool ListModeMatcher::Matches(User *u, bool full) const
+{
+	std::vector<Entry *> candidates;
+	this->GetCandidates(u, candidates);
+
+	for (unsigned i = 0; i < candidates.size(); ++i)
+		if (candidates[i]->Matches(u, full))
+			return true;
+
+	return false;
+}
+
+void ListModeMatcher::GetMatches(User *u, bool full, std::vector<Anope::string> &matches) const
+{
+	std::vector<Entry *> candidates;
+	this->GetCandidates(u, candidates);
+
+	/* An entry can be a candidate more than once, eg for both its host and its range */
+	std::sort(candidates.begin(), candidates.end());
+	candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+	for (unsigned i = 0; i < candidates.size(); ++i)
+		if (candidates[i]->Matches(u, full))
+			matches.push_back(candidates[i]->GetMask());
+}
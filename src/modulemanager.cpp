@@ -22,6 +22,7 @@
 
 std::list<Module *> ModuleManager::Modules;
 std::vector<Module *> ModuleManager::EventHandlers[I_SIZE];
+bool ModuleManager::ProfileHooks = false;
 
 #ifdef _WIN32
 void ModuleManager::CleanupRuntimeDirectory()
@@ -393,6 +394,31 @@ ModuleReturn ModuleManager::DeleteModule(Module *m)
 	return MOD_ERR_OK;
 }
 
+void ModuleManager::ProfileEvent(Module *mod, Implementation i, const char *name, uint64_t started)
+{
+	/* Set while logging a slow event, as logging calls events itself */
+	static bool logging = false;
+
+	uint64_t now = Anope::MicroTime(), t = now > started ? now - started : 0;
+
+	if (mod->event_stats.empty())
+		mod->event_stats.resize(I_SIZE);
+
+	EventStats &stats = mod->event_stats[i];
+	stats.name = name;
+	++stats.count;
+	stats.time += t;
+	if (t > stats.max)
+		stats.max = t;
+
+	if (!logging && Config && Config->SlowHookThreshold && t >= Config->SlowHookThreshold * 1000)
+	{
+		logging = true;
+		Log() << "Module " << mod->name << " took " << t / 1000 << "ms to handle " << name;
+		logging = false;
+	}
+}
+
 void ModuleManager::DetachAll(Module *mod)
 {
 	for (unsigned i = 0; i < I_SIZE; ++i)
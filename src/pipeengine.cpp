@@ -52,6 +52,7 @@ bool Pipe::ProcessRead()
 
 	char dummy[512];
 	while (read(this->GetFD(), dummy, 512) == 512);
+	this->read_state = RS_DRAINED;
 	return true;
 }
 
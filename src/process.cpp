@@ -15,18 +15,89 @@
 #include "servers.h"
 #include "users.h"
 #include "regchannel.h"
+#include "watchdog.h"
 
-void Anope::Process(const Anope::string &buffer)
+/* The parts of a parsed line. These are kept between lines so the memory
+ * allocated for them can be reused by the next line.
+ */
+struct ParsedLine
 {
-	/* If debugging, log the buffer */
-	Log(LOG_RAWIO) << "Received: " << buffer;
-
-	if (buffer.empty())
-		return;
-
 	Anope::map<Anope::string> tags;
 	Anope::string source, command;
 	std::vector<Anope::string> params;
+};
+
+static ParsedLine last_line;
+static bool last_line_used = false;
+
+Anope::map<MessageStats> MessageStatsList;
+
+struct MessageEntry
+{
+	IRCDMessage *message;
+	MessageStats *stats;
+};
+
+/* The protocol module's messages keyed by their lowercase command name. This is
+ * rebuilt from the service registry when services are added or removed, so a
+ * line can be dispatched with a single lookup.
+ */
+typedef TR1NS::unordered_map<Anope::string, MessageEntry, Anope::hash_cs> MessageTable;
+static MessageTable message_table;
+static unsigned message_table_generation = static_cast<unsigned>(-1);
+
+static void BuildMessageTable()
+{
+	message_table.clear();
+	message_table_generation = Service::GetGeneration();
+
+	Module *proto = ModuleManager::FindFirstOf(PROTOCOL);
+	if (!proto)
+		return;
+
+	const Anope::string prefix = proto->name + "/";
+	std::vector<Anope::string> keys = Service::GetServiceKeys("IRCDMessage"), aliases = Service::GetAliasKeys("IRCDMessage");
+	keys.insert(keys.end(), aliases.begin(), aliases.end());
+
+	for (unsigned i = 0; i < keys.size(); ++i)
+	{
+		const Anope::string &key = keys[i];
+		if (key.length() <= prefix.length() || key.find(prefix) != 0)
+			continue;
+
+		IRCDMessage *m = static_cast<IRCDMessage *>(Service::FindService("IRCDMessage", key));
+		if (m)
+		{
+			const Anope::string command = key.substr(prefix.length());
+			MessageEntry &entry = message_table[command];
+			entry.message = m;
+			entry.stats = &MessageStatsList[command.upper()];
+		}
+	}
+}
+
+static const MessageEntry *FindMessage(const Anope::string &command)
+{
+	if (message_table_generation != Service::GetGeneration())
+		BuildMessageTable();
+
+	/* Commands are almost always sent in uppercase, fold them into a reused buffer */
+	static Anope::string lowered;
+	lowered = command;
+	for (Anope::string::size_type i = 0; i < lowered.length(); ++i)
+		lowered[i] = Anope::tolower(lowered[i]);
+
+	MessageTable::const_iterator it = message_table.find(lowered);
+	return it != message_table.end() ? &it->second : NULL;
+}
+
+static void ProcessLine(const Anope::string &buffer, ParsedLine &line)
+{
+	Anope::map<Anope::string> &tags = line.tags;
+	Anope::string &source = line.source, &command = line.command;
+	std::vector<Anope::string> &params = line.params;
+	uint64_t started = Anope::MicroTime();
+	Watchdog::Context context("message", buffer);
 
 	if (!IRCD->Parse(buffer, tags, source, command, params))
 		return;
@@ -49,8 +120,6 @@ void Anope::Process(const Anope::string &buffer)
 				Log() << "params " << i << ": " << params[i];
 	}
 
-	static const Anope::string proto_name = ModuleManager::FindFirstOf(PROTOCOL) ? ModuleManager::FindFirstOf(PROTOCOL)->name : "";
-
 	MessageSource src(source);
 
 	EventReturn MOD_RESULT;
@@ -58,13 +127,17 @@ void Anope::Process(const Anope::string &buffer)
 	if (MOD_RESULT == EVENT_STOP)
 		return;
 
-	ServiceReference<IRCDMessage> m("IRCDMessage", proto_name + "/" + command.lower());
-	if (!m)
+	const MessageEntry *entry = FindMessage(command);
+	if (!entry)
 	{
 		Log(LOG_DEBUG) << "unknown message from server (" << buffer << ")";
 		return;
 	}
 
+	/* The entry may not survive running the message, if it unloads a module */
+	IRCDMessage *m = entry->message;
+	MessageStats *stats = entry->stats;
+
 	if (m->HasFlag(IRCDMESSAGE_SOFT_LIMIT) ? (params.size() < m->GetParamCount()) : (params.size() != m->GetParamCount()))
 		Log(LOG_DEBUG) << "invalid parameters for " << command << ": " << params.size() << " != " << m->GetParamCount();
 	else if (m->HasFlag(IRCDMESSAGE_REQUIRE_USER) && !src.GetUser())
@@ -73,52 +146,105 @@ void Anope::Process(const Anope::string &buffer)
 		Log(LOG_DEBUG) << "unexpected non-server source " << source << " for " << command;
 	else
 		m->Run(src, params, tags);
+
+	uint64_t now = Anope::MicroTime();
+	stats->Add(buffer.length(), now > started ? now - started : 0);
+}
+
+void Anope::Process(const Anope::string &buffer)
+{
+	/* If debugging, log the buffer */
+	Log(LOG_RAWIO) << "Received: " << buffer;
+
+	if (buffer.empty())
+		return;
+
+	/* Lines processed while another line is being processed get their own buffers */
+	if (last_line_used)
+	{
+		ParsedLine line;
+		ProcessLine(buffer, line);
+		return;
+	}
+
+	last_line_used = true;
+	try
+	{
+		ProcessLine(buffer, last_line);
+	}
+	catch (...)
+	{
+		last_line_used = false;
+		throw;
+	}
+	last_line_used = false;
 }
 
 bool IRCDProto::Parse(const Anope::string &buffer, Anope::map<Anope::string> &tags, Anope::string &source, Anope::string &command, std::vector<Anope::string> &params)
 {
+	/* The output strings may be left over from a previous line. They are
+	 * assigned to rather than replaced so their memory is reused.
+	 */
+	const std::string &buf = buffer.str();
 	MessageTokenizer tokens(buffer);
+	tags.clear();
+	source.clear();
 
 	// This will always exist because of the check in Anope::Process.
-	Anope::string token;
-	tokens.GetMiddle(token);
+	Anope::string::size_type start, len;
+	tokens.GetMiddle(start, len);
 
-	if (token[0] == '@')
+	if (buf[start] == '@')
 	{
 		// The line begins with message tags.
-		sepstream tagstream(token.substr(1), ';');
-		while (tagstream.GetToken(token))
+		for (Anope::string::size_type pos = start + 1, end = start + len; pos < end;)
 		{
-			const Anope::string::size_type valsep = token.find('=');
-			if (valsep == Anope::string::npos)
-			{
-				// Tag has no value.
-				tags[token];
-			}
-			else
+			Anope::string::size_type tagend = buf.find(';', pos);
+			if (tagend == std::string::npos || tagend > end)
+				tagend = end;
+
+			if (tagend > pos)
 			{
-				// Tag has a value
-				tags[token.substr(0, valsep)] = token.substr(valsep + 1);
+				Anope::string::size_type valsep = buf.find('=', pos);
+				if (valsep == std::string::npos || valsep > tagend)
+				{
+					// Tag has no value.
+					tags[buf.substr(pos, tagend - pos)];
+				}
+				else
+				{
+					// Tag has a value
+					tags[buf.substr(pos, valsep - pos)] = buf.substr(valsep + 1, tagend - valsep - 1);
+				}
 			}
+
+			pos = tagend + 1;
 		}
 
-		if (!tokens.GetMiddle(token))
+		if (!tokens.GetMiddle(start, len))
 			return false;
 	}
 
-	if (token[0] == ':')
+	if (buf[start] == ':')
 	{
-		source = token.substr(1);
-		if (!tokens.GetMiddle(token))
+		source.str().assign(buf, start + 1, len - 1);
+		if (!tokens.GetMiddle(start, len))
 			return false;
 	}
 
 	// Store the command name.
-	command = token;
+	command.str().assign(buf, start, len);
 
 	// Retrieve all of the parameters.
-	while (tokens.GetTrailing(token))
-		params.push_back(token);
+	unsigned count = 0;
+	for (; tokens.GetTrailing(start, len); ++count)
+	{
+		if (count < params.size())
+			params[count].str().assign(buf, start, len);
+		else
+			params.push_back(buf.substr(start, len));
+	}
+	params.resize(count);
 
 	return true;
 }
@@ -137,46 +263,69 @@ MessageTokenizer::MessageTokenizer(const Anope::string &msg)
 {
 }
 
-bool MessageTokenizer::GetMiddle(Anope::string &token)
+bool MessageTokenizer::GetMiddle(Anope::string::size_type &start, Anope::string::size_type &len)
 {
 	// If we are past the end of the string we can't do anything.
 	if (position >= message.length())
-	{
-		token.clear();
 		return false;
-	}
+
+	start = position;
 
 	// If we can't find another separator this is the last token in the message.
 	Anope::string::size_type separator = message.find(' ', position);
 	if (separator == Anope::string::npos)
 	{
-		token = message.substr(position);
+		len = message.length() - position;
 		position = message.length();
 		return true;
 	}
 
-	token = message.substr(position, separator - position);
+	len = separator - position;
 	position = message.find_first_not_of(' ', separator);
 	return true;
 }
 
-bool MessageTokenizer::GetTrailing(Anope::string &token)
+bool MessageTokenizer::GetTrailing(Anope::string::size_type &start, Anope::string::size_type &len)
 {
 	// If we are past the end of the string we can't do anything.
 	if (position >= message.length())
-	{
-		token.clear();
 		return false;
-	}
 
 	// If this is true then we have a <trailing> token!
 	if (message[position] == ':')
 	{
-		token = message.substr(position + 1);
+		start = position + 1;
+		len = message.length() - start;
 		position = message.length();
 		return true;
 	}
 
 	// There is no <trailing> token so it must be a <middle> token.
-	return GetMiddle(token);
+	return GetMiddle(start, len);
+}
+
+bool MessageTokenizer::GetMiddle(Anope::string &token)
+{
+	Anope::string::size_type start, len;
+	if (!GetMiddle(start, len))
+	{
+		token.clear();
+		return false;
+	}
+
+	token = message.substr(start, len);
+	return true;
+}
+
+bool MessageTokenizer::GetTrailing(Anope::string &token)
+{
+	Anope::string::size_type start, len;
+	if (!GetTrailing(start, len))
+	{
+		token.clear();
+		return false;
+	}
+
+	token = message.substr(start, len);
+	return true;
 }
@@ -114,7 +114,7 @@ Server::Server(Server *up, const Anope::string &sname, unsigned shops, const Ano
 					IRCD->SendChannel(c);
 				else
 					for (Channel::ChanUserList::const_iterator cit = c->users.begin(), cit_end = c->users.end(); cit != cit_end; ++cit)
-						IRCD->SendJoin(cit->second->user, c, &cit->second->status);
+						IRCD->SendJoin((*cit)->user, c, &(*cit)->status);
 
 				for (Channel::ModeList::const_iterator it2 = c->GetModes().begin(); it2 != c->GetModes().end(); ++it2)
 				{
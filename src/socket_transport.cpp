@@ -13,7 +13,187 @@
 #include "sockets.h"
 #include "socketengine.h"
 
-BufferedSocket::BufferedSocket()
+const size_t SocketBuffer::ChunkSize;
+
+SocketBuffer::SocketBuffer() : spare(NULL), len(0)
+{
+}
+
+SocketBuffer::~SocketBuffer()
+{
+	this->Clear();
+	delete this->spare;
+}
+
+SocketBuffer::Chunk *SocketBuffer::NewChunk()
+{
+	Chunk *c = this->spare;
+	if (c != NULL)
+		this->spare = NULL;
+	else
+		c = new Chunk();
+	c->start = c->end = 0;
+	return c;
+}
+
+void SocketBuffer::FreeChunk(Chunk *c)
+{
+	if (this->spare == NULL)
+		this->spare = c;
+	else
+		delete c;
+}
+
+void SocketBuffer::Append(const char *data, size_t l)
+{
+	this->len += l;
+
+	while (l > 0)
+	{
+		if (this->chunks.empty() || this->chunks.back()->end == ChunkSize)
+			this->chunks.push_back(this->NewChunk());
+
+		Chunk *c = this->chunks.back();
+		size_t n = std::min(l, ChunkSize - c->end);
+		memcpy(c->data + c->end, data, n);
+		c->end += n;
+		data += n;
+		l -= n;
+	}
+}
+
+void SocketBuffer::Append(const Anope::string &data)
+{
+	this->Append(data.c_str(), data.length());
+}
+
+size_t SocketBuffer::Find(char c, size_t pos) const
+{
+	size_t offset = 0;
+
+	for (std::deque<Chunk *>::const_iterator it = this->chunks.begin(), it_end = this->chunks.end(); it != it_end; ++it)
+	{
+		const Chunk *ch = *it;
+		size_t clen = ch->end - ch->start;
+
+		if (pos < offset + clen)
+		{
+			size_t skip = pos > offset ? pos - offset : 0;
+			const char *p = static_cast<const char *>(memchr(ch->data + ch->start + skip, c, clen - skip));
+			if (p != NULL)
+				return offset + (p - (ch->data + ch->start));
+		}
+
+		offset += clen;
+	}
+
+	return Anope::string::npos;
+}
+
+void SocketBuffer::Consume(size_t l)
+{
+	if (l > this->len)
+		l = this->len;
+	this->len -= l;
+
+	while (l > 0)
+	{
+		Chunk *c = this->chunks.front();
+		size_t n = std::min(l, c->end - c->start);
+		c->start += n;
+		l -= n;
+
+		if (c->start == c->end)
+		{
+			this->chunks.pop_front();
+			this->FreeChunk(c);
+		}
+	}
+}
+
+void SocketBuffer::Extract(Anope::string &out, size_t l)
+{
+	if (l > this->len)
+		l = this->len;
+
+	out.clear();
+	out.str().reserve(l);
+
+	for (std::deque<Chunk *>::const_iterator it = this->chunks.begin(), it_end = this->chunks.end(); it != it_end && out.length() < l; ++it)
+	{
+		const Chunk *c = *it;
+		out.append(c->data + c->start, std::min(l - out.length(), c->end - c->start));
+	}
+
+	this->Consume(l);
+}
+
+void SocketBuffer::LTrim(const char *chars)
+{
+	while (!this->chunks.empty())
+	{
+		Chunk *c = this->chunks.front();
+		while (c->start < c->end && c->data[c->start] && strchr(chars, c->data[c->start]))
+		{
+			++c->start;
+			--this->len;
+		}
+
+		if (c->start != c->end)
+			break;
+
+		this->chunks.pop_front();
+		this->FreeChunk(c);
+	}
+}
+
+const char *SocketBuffer::Front(size_t &l) const
+{
+	if (this->chunks.empty())
+	{
+		l = 0;
+		return NULL;
+	}
+
+	const Chunk *c = this->chunks.front();
+	l = c->end - c->start;
+	return c->data + c->start;
+}
+
+int SocketBuffer::GetBlocks(iovec *iov, int max) const
+{
+	int count = 0;
+
+	for (std::deque<Chunk *>::const_iterator it = this->chunks.begin(), it_end = this->chunks.end(); it != it_end && count < max; ++it)
+	{
+		Chunk *c = *it;
+		iov[count].iov_base = c->data + c->start;
+		iov[count].iov_len = c->end - c->start;
+		++count;
+	}
+
+	return count;
+}
+
+size_t SocketBuffer::Length() const
+{
+	return this->len;
+}
+
+bool SocketBuffer::Empty() const
+{
+	return this->len == 0;
+}
+
+void SocketBuffer::Clear()
+{
+	for (std::deque<Chunk *>::iterator it = this->chunks.begin(), it_end = this->chunks.end(); it != it_end; ++it)
+		this->FreeChunk(*it);
+	this->chunks.clear();
+	this->len = 0;
+}
+
+BufferedSocket::BufferedSocket() : read_scanned(0), recv_len(0)
 {
 }
 
@@ -27,29 +207,40 @@ bool BufferedSocket::ProcessRead()
 
 	this->recv_len = 0;
 
-	int len = this->io->Recv(this, tbuffer, sizeof(tbuffer) - 1);
+	int len = this->io->Recv(this, tbuffer, sizeof(tbuffer));
 	if (len == 0)
 		return false;
 	if (len < 0)
-		return SocketEngine::IgnoreErrno();
+	{
+		if (!SocketEngine::IgnoreErrno())
+			return false;
+		this->read_state = RS_DRAINED;
+		return true;
+	}
 
-	tbuffer[len] = 0;
-	this->read_buffer.append(tbuffer);
+	this->read_buffer.Append(tbuffer, len);
 	this->recv_len = len;
+	this->read_state = RS_MORE;
 
 	return true;
 }
 
 bool BufferedSocket::ProcessWrite()
 {
-	int count = this->io->Send(this, this->write_buffer);
+	if (this->write_buffer.Empty())
+	{
+		SocketEngine::Change(this, false, SF_WRITABLE);
+		return true;
+	}
+
+	int count = this->io->Writev(this, this->write_buffer);
 	if (count == 0)
 		return false;
 	if (count < 0)
 		return SocketEngine::IgnoreErrno();
 
-	this->write_buffer = this->write_buffer.substr(count);
-	if (this->write_buffer.empty())
+	this->write_buffer.Consume(count);
+	if (this->write_buffer.Empty())
 		SocketEngine::Change(this, false, SF_WRITABLE);
 
 	return true;
@@ -57,18 +248,24 @@ bool BufferedSocket::ProcessWrite()
 
 const Anope::string BufferedSocket::GetLine()
 {
-	size_t s = this->read_buffer.find('\n');
+	size_t s = this->read_buffer.Find('\n', this->read_scanned);
 	if (s == Anope::string::npos)
+	{
+		/* Don't search this data again when more is received */
+		this->read_scanned = this->read_buffer.Length();
 		return "";
-	Anope::string str = this->read_buffer.substr(0, s + 1);
-	this->read_buffer.erase(0, s + 1);
-	this->read_buffer.ltrim("\r\n");
+	}
+	Anope::string str;
+	this->read_buffer.Extract(str, s + 1);
+	this->read_buffer.LTrim("\r\n");
+	this->read_scanned = 0;
 	return str.trim("\r\n");
 }
 
 void BufferedSocket::Write(const char *buffer, size_t l)
 {
-	this->write_buffer += buffer + Anope::string("\r\n");
+	this->write_buffer.Append(buffer, l);
+	this->write_buffer.Append("\r\n", 2);
 	SocketEngine::Change(this, true, SF_WRITABLE);
 }
 
@@ -84,7 +281,7 @@ void BufferedSocket::Write(const char *message, ...)
 	int len = vsnprintf(tbuffer, sizeof(tbuffer), message, vi);
 	va_end(vi);
 
-	this->Write(tbuffer, std::min(len, static_cast<int>(sizeof(tbuffer))));
+	this->Write(tbuffer, std::min(len, static_cast<int>(sizeof(tbuffer) - 1)));
 }
 
 void BufferedSocket::Write(const Anope::string &message)
@@ -99,22 +296,10 @@ int BufferedSocket::ReadBufferLen() const
 
 int BufferedSocket::WriteBufferLen() const
 {
-	return this->write_buffer.length();
+	return this->write_buffer.Length();
 }
 
 
-BinarySocket::DataBlock::DataBlock(const char *b, size_t l)
-{
-	this->orig = this->buf = new char[l];
-	memcpy(this->buf, b, l);
-	this->len = l;
-}
-
-BinarySocket::DataBlock::~DataBlock()
-{
-	delete [] this->orig;
-}
-
 BinarySocket::BinarySocket()
 {
 }
@@ -128,37 +313,32 @@ bool BinarySocket::ProcessRead()
 	char tbuffer[NET_BUFSIZE];
 
 	int len = this->io->Recv(this, tbuffer, sizeof(tbuffer));
+	if (len < 0 && SocketEngine::IgnoreErrno())
+	{
+		this->read_state = RS_DRAINED;
+		return true;
+	}
 	if (len <= 0)
 		return false;
 
+	this->read_state = RS_MORE;
 	return this->Read(tbuffer, len);
 }
 
 bool BinarySocket::ProcessWrite()
 {
-	if (this->write_buffer.empty())
+	if (this->write_buffer.Empty())
 	{
 		SocketEngine::Change(this, false, SF_WRITABLE);
 		return true;
 	}
 
-	DataBlock *d = this->write_buffer.front();
-
-	int len = this->io->Send(this, d->buf, d->len);
+	int len = this->io->Writev(this, this->write_buffer);
 	if (len <= -1)
 		return false;
-	else if (static_cast<size_t>(len) == d->len)
-	{
-		delete d;
-		this->write_buffer.pop_front();
-	}
-	else
-	{
-		d->buf += len;
-		d->len -= len;
-	}
 
-	if (this->write_buffer.empty())
+	this->write_buffer.Consume(len);
+	if (this->write_buffer.Empty())
 		SocketEngine::Change(this, false, SF_WRITABLE);
 
 	return true;
@@ -168,7 +348,7 @@ void BinarySocket::Write(const char *buffer, size_t l)
 {
 	if (l == 0)
 		return;
-	this->write_buffer.push_back(new DataBlock(buffer, l));
+	this->write_buffer.Append(buffer, l);
 	SocketEngine::Change(this, true, SF_WRITABLE);
 }
 
@@ -14,14 +14,132 @@
 #include "sockets.h"
 #include "socketengine.h"
 #include "config.h"
+#include "timers.h"
+#include "watchdog.h"
 
 #include <sys/epoll.h>
+#include <sys/ioctl.h>
 #include <ulimit.h>
 #include <errno.h>
 
 static int EngineHandle;
 static std::vector<epoll_event> events;
 
+/* The most reads done on an edge triggered socket for one event before
+ * other sockets get a turn
+ */
+static const int MaxEdgeReads = 16;
+
+struct FDInfo
+{
+	/* The socket using this fd, if it is registered */
+	Socket *sock;
+	/* Whether this fd is registered edge triggered */
+	bool edge;
+	/* Whether this fd is in the ready list */
+	bool ready;
+
+	FDInfo() : sock(NULL), edge(false), ready(false) { }
+};
+
+/* Registered sockets indexed by fd, so events can be dispatched without a lookup in Sockets */
+static std::vector<FDInfo> fd_info;
+/* Edge triggered fds which must be processed without waiting for another event */
+static std::vector<int> ready;
+
+static inline FDInfo &GetInfo(int fd)
+{
+	if (static_cast<unsigned>(fd) >= fd_info.size())
+		fd_info.resize(fd + 1);
+	return fd_info[fd];
+}
+
+static void MarkReady(int fd)
+{
+	FDInfo &info = GetInfo(fd);
+	if (!info.ready)
+	{
+		info.ready = true;
+		ready.push_back(fd);
+	}
+}
+
+/* Whether a socket has been read until it has nothing left. The global errno can't be used
+ * for this, as sockets may do anything after reading, such as processing what they read.
+ */
+static bool IsDrained(Socket *s)
+{
+	if (s->read_state == Socket::RS_DRAINED)
+		return true;
+	if (s->read_state == Socket::RS_MORE)
+		return false;
+
+	/* The socket can't tell, so ask the kernel. This can't see data buffered in userspace,
+	 * which is why sockets which read through a SocketIO say for themselves.
+	 */
+	int pending;
+	return ioctl(s->GetFD(), FIONREAD, &pending) == 0 && pending == 0;
+}
+
+/* Read from an edge triggered socket until it has nothing left to read */
+static bool DrainRead(Socket *s)
+{
+	for (int i = 0; i < MaxEdgeReads; ++i)
+	{
+		s->read_state = Socket::RS_UNKNOWN;
+
+		if (!s->ProcessRead())
+			return false;
+
+		if (s->flags[SF_DEAD] || IsDrained(s))
+			return true;
+	}
+
+	/* There may be more to read, come back to this socket once others have had a turn */
+	MarkReady(s->GetFD());
+	return true;
+}
+
+static void ProcessSocket(Socket *s, uint32_t ev)
+{
+	Watchdog::Context context("socket", s->GetFD());
+	bool edge = GetInfo(s->GetFD()).edge;
+
+	if (ev & (EPOLLHUP | EPOLLERR))
+	{
+		s->ProcessError();
+		delete s;
+		return;
+	}
+
+	if (!s->Process())
+	{
+		if (s->flags[SF_DEAD])
+			delete s;
+		return;
+	}
+
+	if (!edge)
+	{
+		if ((ev & EPOLLIN) && !s->ProcessRead())
+			s->flags[SF_DEAD] = true;
+
+		if ((ev & EPOLLOUT) && !s->ProcessWrite())
+			s->flags[SF_DEAD] = true;
+	}
+	else
+	{
+		if ((ev & EPOLLIN) && s->flags[SF_READABLE] && !DrainRead(s))
+			s->flags[SF_DEAD] = true;
+
+		if ((ev & EPOLLOUT) && s->flags[SF_WRITABLE] && !s->flags[SF_DEAD] && !s->ProcessWrite())
+			s->flags[SF_DEAD] = true;
+	}
+
+	if (s->flags[SF_DEAD])
+		delete s;
+}
+
 void SocketEngine::Init()
 {
 	EngineHandle = epoll_create(4);
@@ -49,23 +167,49 @@ void SocketEngine::Change(Socket *s, bool set, SocketFlag flag)
 
 	bool now_registered = s->flags[SF_READABLE] || s->flags[SF_WRITABLE];
 
+	FDInfo &info = GetInfo(s->GetFD());
+
 	epoll_event ev;
 
 	memset(&ev, 0, sizeof(ev));
 
-	ev.events = (s->flags[SF_READABLE] ? EPOLLIN : 0) | (s->flags[SF_WRITABLE] ? EPOLLOUT : 0);
 	ev.data.fd = s->GetFD();
 
 	int mod;
 	if (!before_registered && now_registered)
+	{
 		mod = EPOLL_CTL_ADD;
+		info.sock = s;
+		info.edge = Config && Config->GetBlock("options")->Get<bool>("edgetriggered");
+	}
 	else if (before_registered && !now_registered)
+	{
 		mod = EPOLL_CTL_DEL;
+		info.sock = NULL;
+		info.ready = false;
+	}
 	else if (before_registered && now_registered)
+	{
+		/* Edge triggered sockets are always registered for both events, so there
+		 * is nothing to change. The socket may already be readable or writable
+		 * though, in which case no new event will come for it.
+		 */
+		if (info.edge)
+		{
+			if (set)
+				MarkReady(s->GetFD());
+			return;
+		}
 		mod = EPOLL_CTL_MOD;
+	}
 	else
 		return;
 
+	if (info.edge)
+		ev.events = EPOLLIN | EPOLLOUT | EPOLLET;
+	else
+		ev.events = (s->flags[SF_READABLE] ? EPOLLIN : 0) | (s->flags[SF_WRITABLE] ? EPOLLOUT : 0);
+
 	if (epoll_ctl(EngineHandle, mod, ev.data.fd, &ev) == -1)
 		 throw SocketException("Unable to epoll_ctl() fd " + stringify(ev.data.fd) + " to epoll: " + Anope::LastError());
 }
@@ -75,8 +219,12 @@ void SocketEngine::Process()
 	if (Sockets.size() > events.size())
 		events.resize(events.size() * 2);
 
-	int total = epoll_wait(EngineHandle, &events.front(), events.size(), Config->ReadTimeout * 1000);
+	/* Don't wait for new events if there are sockets which are already ready */
+	int timeout = ready.empty() ? TimerManager::GetWaitTime(Config->ReadTimeout * 1000) : 0;
+
+	int total = epoll_wait(EngineHandle, &events.front(), events.size(), timeout);
 	Anope::CurTime = time(NULL);
+	Watchdog::Begin();
 
 	/* EINTR can be given if the read timeout expires */
 	if (total == -1)
@@ -90,32 +238,30 @@ void SocketEngine::Process()
 	{
 		epoll_event &ev = events[i];
 
-		std::map<int, Socket *>::iterator it = Sockets.find(ev.data.fd);
-		if (it == Sockets.end())
+		Socket *s = GetInfo(ev.data.fd).sock;
+		if (s == NULL)
 			continue;
-		Socket *s = it->second;
 
-		if (ev.events & (EPOLLHUP | EPOLLERR))
-		{
-			s->ProcessError();
-			delete s;
-			continue;
-		}
+		ProcessSocket(s, ev.events);
+	}
 
-		if (!s->Process())
-		{
-			if (s->flags[SF_DEAD])
-				delete s;
-			continue;
-		}
+	if (!ready.empty())
+	{
+		std::vector<int> processing;
+		processing.swap(ready);
 
-		if ((ev.events & EPOLLIN) && !s->ProcessRead())
-			s->flags[SF_DEAD] = true;
+		for (unsigned i = 0; i < processing.size(); ++i)
+		{
+			FDInfo &info = GetInfo(processing[i]);
+			if (!info.ready)
+				continue;
+			info.ready = false;
 
-		if ((ev.events & EPOLLOUT) && !s->ProcessWrite())
-			s->flags[SF_DEAD] = true;
+			Socket *s = info.sock;
+			if (s == NULL)
+				continue;
 
-		if (s->flags[SF_DEAD])
-			delete s;
+			ProcessSocket(s, (s->flags[SF_READABLE] ? EPOLLIN : 0) | (s->flags[SF_WRITABLE] ? EPOLLOUT : 0));
+		}
 	}
 }
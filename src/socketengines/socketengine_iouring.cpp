@@ -0,0 +1,308 @@
+/*
+ *
+ * (C) 2003-2020 Anope Team
+ * Contact us at team@anope.org
+ *
+ * Please read COPYING and README for further details.
+ *
+ * Based on the original code of Epona by Lara.
+ * Based on the original code of Services by Andy Church.
+ */
+
+#include "services.h"
+#include "anope.h"
+#include "sockets.h"
+#include "socketengine.h"
+#include "logger.h"
+#include "config.h"
+#include "timers.h"
+#include "watchdog.h"
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <poll.h>
+#include <errno.h>
+
+/* Sockets are watched with one shot poll requests which are rearmed after
+ * every event. Socket::ProcessRead() only reads a limited amount of data at
+ * a time, so the level triggered behaviour of rearming is required. All of
+ * the requests queued during one pass are submitted together in the same
+ * io_uring_enter() call that waits for events.
+ */
+
+static const unsigned RingEntries = 256;
+
+/* user_data of requests whose completions are not for a socket */
+static const uint64_t TimeoutData = ~static_cast<uint64_t>(0);
+static const uint64_t RemoveData = TimeoutData - 1;
+
+static int ring_fd = -1;
+
+static void *sq_ptr, *cq_ptr;
+static size_t sq_size, cq_size;
+
+static unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+static unsigned *cq_head, *cq_tail, *cq_mask;
+static io_uring_sqe *sqes;
+static size_t sqes_size;
+static io_uring_cqe *cqes;
+
+/* Number of requests queued but not yet submitted */
+static unsigned to_submit;
+
+/* The state of each fd. The generation is part of every request's user_data
+ * so completions for a request which has since been removed can be ignored.
+ */
+struct FDState
+{
+	uint32_t generation;
+	/* Events currently being polled for */
+	short events;
+	/* Whether there is a poll request pending for this fd */
+	bool armed;
+
+	FDState() : generation(0), events(0), armed(false) { }
+};
+static std::vector<FDState> fd_states;
+
+static __kernel_timespec wait_timeout;
+
+static inline uint64_t MakeData(int fd, uint32_t generation)
+{
+	return (static_cast<uint64_t>(generation) << 32) | static_cast<uint32_t>(fd);
+}
+
+static inline FDState &GetState(int fd)
+{
+	if (static_cast<unsigned>(fd) >= fd_states.size())
+		fd_states.resize(fd + 1);
+	return fd_states[fd];
+}
+
+static int Enter(unsigned submit, unsigned min_complete, unsigned flags)
+{
+	return syscall(__NR_io_uring_enter, ring_fd, submit, min_complete, flags, NULL, 0);
+}
+
+static io_uring_sqe *GetSQE()
+{
+	unsigned tail = *sq_tail;
+
+	if (tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) == RingEntries)
+	{
+		/* The ring is full, hand what we have to the kernel now */
+		if (Enter(to_submit, 0, 0) < 0)
+			throw SocketException("Unable to submit to io_uring: " + Anope::LastError());
+		to_submit = 0;
+	}
+
+	unsigned index = tail & *sq_mask;
+	io_uring_sqe *sqe = &sqes[index];
+	memset(sqe, 0, sizeof(*sqe));
+	sq_array[index] = index;
+	__atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+	++to_submit;
+
+	return sqe;
+}
+
+static void Arm(int fd, FDState &state)
+{
+	io_uring_sqe *sqe = GetSQE();
+	sqe->opcode = IORING_OP_POLL_ADD;
+	sqe->fd = fd;
+	sqe->poll_events = state.events;
+	sqe->user_data = MakeData(fd, state.generation);
+	state.armed = true;
+}
+
+static void Disarm(int fd, FDState &state)
+{
+	if (state.armed)
+	{
+		io_uring_sqe *sqe = GetSQE();
+		sqe->opcode = IORING_OP_POLL_REMOVE;
+		sqe->fd = -1;
+		sqe->addr = MakeData(fd, state.generation);
+		sqe->user_data = RemoveData;
+		state.armed = false;
+	}
+
+	++state.generation;
+}
+
+void SocketEngine::Init()
+{
+	io_uring_params params;
+	memset(&params, 0, sizeof(params));
+
+	ring_fd = syscall(__NR_io_uring_setup, RingEntries, &params);
+	if (ring_fd < 0)
+		throw SocketException("Could not initialize io_uring socket engine: " + Anope::LastError());
+
+	sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+	if (params.features & IORING_FEAT_SINGLE_MMAP)
+		sq_size = cq_size = std::max(sq_size, cq_size);
+
+	sq_ptr = mmap(NULL, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+	if (sq_ptr == MAP_FAILED)
+		throw SocketException("Could not map io_uring submission queue: " + Anope::LastError());
+
+	if (params.features & IORING_FEAT_SINGLE_MMAP)
+		cq_ptr = sq_ptr;
+	else
+	{
+		cq_ptr = mmap(NULL, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+		if (cq_ptr == MAP_FAILED)
+			throw SocketException("Could not map io_uring completion queue: " + Anope::LastError());
+	}
+
+	sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+	void *sqes_ptr = mmap(NULL, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+	if (sqes_ptr == MAP_FAILED)
+		throw SocketException("Could not map io_uring submission entries: " + Anope::LastError());
+
+	char *sq = static_cast<char *>(sq_ptr), *cq = static_cast<char *>(cq_ptr);
+
+	sq_head = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+	sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+	sq_mask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+	sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+	sqes = static_cast<io_uring_sqe *>(sqes_ptr);
+
+	cq_head = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+	cq_tail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+	cq_mask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+	cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+	to_submit = 0;
+	fd_states.resize(DefaultSize);
+}
+
+void SocketEngine::Shutdown()
+{
+	while (!Sockets.empty())
+		delete Sockets.begin()->second;
+
+	munmap(sqes, sqes_size);
+	if (cq_ptr != sq_ptr)
+		munmap(cq_ptr, cq_size);
+	munmap(sq_ptr, sq_size);
+	close(ring_fd);
+	ring_fd = -1;
+}
+
+void SocketEngine::Change(Socket *s, bool set, SocketFlag flag)
+{
+	if (set == s->flags[flag])
+		return;
+
+	s->flags[flag] = set;
+
+	if (flag != SF_READABLE && flag != SF_WRITABLE)
+		return;
+
+	FDState &state = GetState(s->GetFD());
+	Disarm(s->GetFD(), state);
+
+	state.events = (s->flags[SF_READABLE] ? POLLIN : 0) | (s->flags[SF_WRITABLE] ? POLLOUT : 0);
+	if (state.events)
+		Arm(s->GetFD(), state);
+}
+
+void SocketEngine::Process()
+{
+	/* Wake up once a completion is posted or the next timer is due */
+	long wait = TimerManager::GetWaitTime(Config->ReadTimeout * 1000);
+	wait_timeout.tv_sec = wait / 1000;
+	wait_timeout.tv_nsec = (wait % 1000) * 1000000;
+
+	io_uring_sqe *sqe = GetSQE();
+	sqe->opcode = IORING_OP_TIMEOUT;
+	sqe->fd = -1;
+	sqe->addr = reinterpret_cast<uintptr_t>(&wait_timeout);
+	sqe->len = 1;
+	sqe->off = 1;
+	sqe->user_data = TimeoutData;
+
+	int total = Enter(to_submit, 1, IORING_ENTER_GETEVENTS);
+	Anope::CurTime = time(NULL);
+	Watchdog::Begin();
+
+	/* EINTR can be given if the read timeout expires */
+	if (total < 0)
+	{
+		if (errno != EINTR)
+			Log() << "SockEngine::Process(): error: " << Anope::LastError();
+		return;
+	}
+	to_submit -= std::min(to_submit, static_cast<unsigned>(total));
+
+	/* Copy the completions out first so the ring can be reused while sockets are processed */
+	std::vector<io_uring_cqe> completions;
+	unsigned head = *cq_head, tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+	completions.reserve(tail - head);
+	for (; head != tail; ++head)
+		completions.push_back(cqes[head & *cq_mask]);
+	__atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+
+	for (unsigned i = 0; i < completions.size(); ++i)
+	{
+		const io_uring_cqe &cqe = completions[i];
+
+		if (cqe.user_data == TimeoutData || cqe.user_data == RemoveData)
+			continue;
+
+		int fd = static_cast<int>(cqe.user_data & 0xFFFFFFFF);
+		uint32_t generation = static_cast<uint32_t>(cqe.user_data >> 32);
+
+		FDState &state = GetState(fd);
+		if (state.generation != generation)
+			continue;
+		state.armed = false;
+
+		std::map<int, Socket *>::iterator it = Sockets.find(fd);
+		if (it == Sockets.end())
+			continue;
+		Socket *s = it->second;
+		Watchdog::Context context("socket", s->GetFD());
+
+		if (cqe.res < 0)
+		{
+			Log(LOG_DEBUG) << "SockEngine::Process(): poll on fd " << fd << " failed: " << strerror(-cqe.res);
+			s->ProcessError();
+			delete s;
+			continue;
+		}
+
+		if (cqe.res & (POLLHUP | POLLERR))
+		{
+			s->ProcessError();
+			delete s;
+			continue;
+		}
+
+		if (s->Process())
+		{
+			if ((cqe.res & POLLIN) && !s->ProcessRead())
+				s->flags[SF_DEAD] = true;
+
+			if ((cqe.res & POLLOUT) && !s->ProcessWrite())
+				s->flags[SF_DEAD] = true;
+		}
+
+		if (s->flags[SF_DEAD])
+		{
+			delete s;
+			continue;
+		}
+
+		/* Processing may have already rearmed this fd by changing its flags */
+		FDState &after = GetState(fd);
+		if (!after.armed && after.events)
+			Arm(fd, after);
+	}
+}
@@ -15,6 +15,8 @@
 #include "socketengine.h"
 #include "logger.h"
 #include "config.h"
+#include "timers.h"
+#include "watchdog.h"
 
 #include <sys/types.h>
 #include <sys/event.h>
@@ -74,10 +76,12 @@ void SocketEngine::Process()
 	if (Sockets.size() > event_events.size())
 		event_events.resize(event_events.size() * 2);
 
-	static timespec kq_timespec = { Config->ReadTimeout, 0 };
+	long wait = TimerManager::GetWaitTime(Config->ReadTimeout * 1000);
+	timespec kq_timespec = { wait / 1000, (wait % 1000) * 1000000 };
 	int total = kevent(kq_fd, &change_events.front(), change_count, &event_events.front(), event_events.size(), &kq_timespec);
 	change_count = 0;
 	Anope::CurTime = time(NULL);
+	Watchdog::Begin();
 
 	/* EINTR can be given if the read timeout expires */
 	if (total == -1)
@@ -97,6 +101,7 @@ void SocketEngine::Process()
 		if (it == Sockets.end())
 			continue;
 		Socket *s = it->second;
+		Watchdog::Context context("socket", s->GetFD());
 
 		if (event.flags & EV_EOF)
 		{
@@ -14,6 +14,8 @@
 #include "sockets.h"
 #include "socketengine.h"
 #include "config.h"
+#include "timers.h"
+#include "watchdog.h"
 
 #include <errno.h>
 
@@ -99,8 +101,9 @@ void SocketEngine::Change(Socket *s, bool set, SocketFlag flag)
 
 void SocketEngine::Process()
 {
-	int total = poll(&events.front(), events.size(), Config->ReadTimeout * 1000);
+	int total = poll(&events.front(), events.size(), TimerManager::GetWaitTime(Config->ReadTimeout * 1000));
 	Anope::CurTime = time(NULL);
+	Watchdog::Begin();
 
 	/* EINTR can be given if the read timeout expires */
 	if (total < 0)
@@ -121,6 +124,7 @@ void SocketEngine::Process()
 		if (it == Sockets.end())
 			continue;
 		Socket *s = it->second;
+		Watchdog::Context context("socket", s->GetFD());
 
 		if (ev->revents & (POLLERR | POLLRDHUP))
 		{
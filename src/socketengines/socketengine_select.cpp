@@ -15,6 +15,8 @@
 #include "socketengine.h"
 #include "logger.h"
 #include "config.h"
+#include "timers.h"
+#include "watchdog.h"
 
 #ifdef _AIX
 # undef FD_ZERO
@@ -85,8 +87,9 @@ void SocketEngine::Process()
 {
 	fd_set rfdset = ReadFDs, wfdset = WriteFDs, efdset = ReadFDs;
 	timeval tval;
-	tval.tv_sec = Config->ReadTimeout;
-	tval.tv_usec = 0;
+	long wait = TimerManager::GetWaitTime(Config->ReadTimeout * 1000);
+	tval.tv_sec = wait / 1000;
+	tval.tv_usec = (wait % 1000) * 1000;
 
 #ifdef _WIN32
 	/* We can use the socket engine to "sleep" services for a period of
@@ -97,13 +100,14 @@ void SocketEngine::Process()
 	 */
 	if (FDCount == 0)
 	{
-		sleep(tval.tv_sec);
+		sleep(std::max<long>(tval.tv_sec, 1));
 		return;
 	}
 #endif
 
 	int sresult = select(MaxFD + 1, &rfdset, &wfdset, &efdset, &tval);
 	Anope::CurTime = time(NULL);
+	Watchdog::Begin();
 
 	if (sresult == -1)
 	{
@@ -121,6 +125,8 @@ void SocketEngine::Process()
 			if (has_read || has_write || has_error)
 				++processed;
 
+			Watchdog::Context context("socket", s->GetFD());
+
 			if (has_error)
 			{
 				s->ProcessError();
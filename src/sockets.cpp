@@ -407,6 +407,38 @@ int SocketIO::Send(Socket *s, const Anope::string &buf)
 	return this->Send(s, buf.c_str(), buf.length());
 }
 
+int SocketIO::Writev(Socket *s, const iovec *iov, int iovcnt)
+{
+	/* Only plain sockets can be written to directly. Anything layered on top of
+	 * them, such as SSL, has to go through Send() one block at a time.
+	 */
+	if (this != &NormalSocketIO)
+	{
+		int total = 0;
+		for (int j = 0; j < iovcnt; ++j)
+		{
+			int i = this->Send(s, static_cast<const char *>(iov[j].iov_base), iov[j].iov_len);
+			if (i <= 0)
+				return total > 0 ? total : i;
+			total += i;
+			if (static_cast<size_t>(i) < iov[j].iov_len)
+				break;
+		}
+		return total;
+	}
+
+	int i = writev(s->GetFD(), iov, iovcnt);
+	if (i > 0)
+		TotalWritten += i;
+	return i;
+}
+
+int SocketIO::Writev(Socket *s, const SocketBuffer &buf)
+{
+	iovec iov[64];
+	return this->Writev(s, iov, buf.GetBlocks(iov, sizeof(iov) / sizeof(*iov)));
+}
+
 ClientSocket *SocketIO::Accept(ListenSocket *s)
 {
 	sockaddrs conaddr;
@@ -492,6 +524,7 @@ Socket::Socket(int s, bool i, int type)
 {
 	this->io = &NormalSocketIO;
 	this->ipv6 = i;
+	this->read_state = RS_UNKNOWN;
 	if (s == -1)
 		this->sock = socket(this->ipv6 ? AF_INET6 : AF_INET, type, 0);
 	else
@@ -579,8 +612,15 @@ bool ListenSocket::ProcessRead()
 	}
 	catch (const SocketException &ex)
 	{
+		/* There are no more connections waiting to be accepted */
+		if (SocketEngine::IgnoreErrno())
+		{
+			this->read_state = RS_DRAINED;
+			return true;
+		}
 		Log() << ex.GetReason();
 	}
+	this->read_state = RS_MORE;
 	return true;
 }
 
@@ -15,6 +15,7 @@
 
 #ifndef _WIN32
 #include <pthread.h>
+#include <sys/time.h>
 #endif
 
 static inline pthread_attr_t *get_engine_attr()
@@ -134,3 +135,20 @@ void Condition::Wait()
 {
 	pthread_cond_wait(&cond, &mutex);
 }
+
+void Condition::Wait(long ms)
+{
+	timeval now;
+	gettimeofday(&now, NULL);
+
+	timespec abstime;
+	abstime.tv_sec = now.tv_sec + ms / 1000;
+	abstime.tv_nsec = now.tv_usec * 1000 + (ms % 1000) * 1000000;
+	if (abstime.tv_nsec >= 1000000000)
+	{
+		++abstime.tv_sec;
+		abstime.tv_nsec -= 1000000000;
+	}
+
+	pthread_cond_timedwait(&cond, &mutex, &abstime);
+}
@@ -8,8 +8,24 @@
 
 #include "services.h"
 #include "timers.h"
+#include "config.h"
+#include "watchdog.h"
 
-std::multimap<time_t, Timer *> TimerManager::Timers;
+#ifndef _WIN32
+#include <sys/time.h>
+#endif
+
+/* The number of seconds covered by the wheel, must be a power of two */
+static const time_t WheelSize = 4096;
+
+/* Timers due within WheelSize seconds, in the slot for the second they are due */
+static std::vector<std::list<Timer *> > Wheel(WheelSize);
+/* Timers due further in the future */
+static std::list<Timer *> Overflow;
+/* The last second the wheel has been ticked for */
+static time_t WheelTime = 0;
+/* The last time timers were ticked */
+static time_t LastCheck = 0;
 
 Timer::Timer(long time_from_now, time_t now, bool repeating)
 {
@@ -18,6 +34,7 @@ Timer::Timer(long time_from_now, time_t now, bool repeating)
 	secs = time_from_now;
 	repeat = repeating;
 	settime = now;
+	list = NULL;
 
 	TimerManager::AddTimer(this);
 }
@@ -29,6 +46,7 @@ Timer::Timer(Module *creator, long time_from_now, time_t now, bool repeating)
 	secs = time_from_now;
 	repeat = repeating;
 	settime = now;
+	list = NULL;
 
 	TimerManager::AddTimer(this);
 }
@@ -80,47 +98,132 @@ Module *Timer::GetOwner() const
 
 void TimerManager::AddTimer(Timer *t)
 {
-	Timers.insert(std::make_pair(t->GetTimer(), t));
+	if (!WheelTime)
+		WheelTime = Anope::CurTime;
+
+	/* Timers which are already due trigger on the next tick */
+	time_t when = std::max(t->GetTimer(), WheelTime + 1);
+
+	std::list<Timer *> &l = when - WheelTime < WheelSize ? Wheel[when & (WheelSize - 1)] : Overflow;
+	t->list = &l;
+	t->pos = l.insert(l.end(), t);
 }
 
 void TimerManager::DelTimer(Timer *t)
 {
-	std::pair<std::multimap<time_t, Timer *>::iterator, std::multimap<time_t, Timer *>::iterator> itpair = Timers.equal_range(t->GetTimer());
-	for (std::multimap<time_t, Timer *>::iterator i = itpair.first; i != itpair.second; ++i)
+	if (t->list != NULL)
+	{
+		t->list->erase(t->pos);
+		t->list = NULL;
+	}
+}
+
+void TimerManager::Cascade()
+{
+	for (std::list<Timer *>::iterator it = Overflow.begin(), it_end = Overflow.end(); it != it_end;)
 	{
-		if (i->second == t)
+		Timer *t = *it;
+
+		if (t->GetTimer() - WheelTime < WheelSize)
 		{
-			Timers.erase(i);
-			break;
+			std::list<Timer *> &l = Wheel[t->GetTimer() & (WheelSize - 1)];
+			t->list = &l;
+			t->pos = l.insert(l.end(), t);
+			it = Overflow.erase(it);
 		}
+		else
+			++it;
 	}
 }
 
-void TimerManager::TickTimers(time_t ctime)
+void TimerManager::Rebuild(time_t ctime)
 {
-	while (!Timers.empty())
+	std::vector<Timer *> timers;
+	for (time_t i = 0; i < WheelSize; ++i)
 	{
-		std::multimap<time_t, Timer *>::iterator it = Timers.begin();
-		Timer *t = it->second;
+		timers.insert(timers.end(), Wheel[i].begin(), Wheel[i].end());
+		Wheel[i].clear();
+	}
+	timers.insert(timers.end(), Overflow.begin(), Overflow.end());
+	Overflow.clear();
 
-		if (t->GetTimer() > ctime)
-			break;
+	WheelTime = ctime - 1;
+	for (unsigned i = 0; i < timers.size(); ++i)
+		AddTimer(timers[i]);
+}
 
-		t->Tick(ctime);
+void TimerManager::TickTimers(time_t ctime)
+{
+	if (Config && ctime - LastCheck < Config->TimeoutCheck)
+		return;
+	LastCheck = ctime;
 
-		if (t->GetRepeat())
-			t->SetTimer(ctime + t->GetSecs());
-		else
-			delete t;
+	if (ctime - WheelTime > WheelSize)
+		Rebuild(ctime);
+
+	while (WheelTime < ctime)
+	{
+		++WheelTime;
+
+		if (!(WheelTime & (WheelSize - 1)))
+			Cascade();
+
+		std::list<Timer *> &slot = Wheel[WheelTime & (WheelSize - 1)];
+		while (!slot.empty())
+		{
+			Timer *t = slot.front();
+			slot.pop_front();
+			t->list = NULL;
+
+			{
+				Watchdog::Context context("timer", t->GetOwner() ? t->GetOwner()->name : "core");
+				t->Tick(ctime);
+			}
+
+			if (t->GetRepeat())
+				t->SetTimer(ctime + t->GetSecs());
+			else
+				delete t;
+		}
 	}
 }
 
 void TimerManager::DeleteTimersFor(Module *m)
 {
-	for (std::multimap<time_t, Timer *>::iterator it = Timers.begin(), it_next = it; it != Timers.end(); it = it_next)
-	{
-		++it_next;
-		if (it->second->GetOwner() == m)
-			delete it->second;
-	}
+	std::vector<Timer *> timers;
+	for (time_t i = 0; i < WheelSize; ++i)
+		for (std::list<Timer *>::iterator it = Wheel[i].begin(), it_end = Wheel[i].end(); it != it_end; ++it)
+			if ((*it)->GetOwner() == m)
+				timers.push_back(*it);
+	for (std::list<Timer *>::iterator it = Overflow.begin(), it_end = Overflow.end(); it != it_end; ++it)
+		if ((*it)->GetOwner() == m)
+			timers.push_back(*it);
+
+	for (unsigned i = 0; i < timers.size(); ++i)
+		delete timers[i];
+}
+
+long TimerManager::GetWaitTime(long max)
+{
+	timeval now;
+	gettimeofday(&now, NULL);
+
+	/* Find the next second with a timer due, not looking further than we would wait anyway */
+	time_t due = 0, limit = now.tv_sec + max / 1000 + 1;
+	for (time_t t = WheelTime + 1; t <= limit && t - WheelTime < WheelSize; ++t)
+		if (!Wheel[t & (WheelSize - 1)].empty())
+		{
+			due = t;
+			break;
+		}
+
+	if (!due)
+		return max;
+
+	/* Timers are not ticked more often than options:timeoutcheck allows */
+	if (Config)
+		due = std::max(due, LastCheck + Config->TimeoutCheck);
+
+	long wait = (due - now.tv_sec) * 1000 - now.tv_usec / 1000;
+	return std::max(0L, std::min(wait, max));
 }
@@ -14,6 +14,7 @@
 #include "config.h"
 #include "protocol.h"
 #include "servers.h"
+#include "socketengine.h"
 
 UplinkSocket *UplinkSock = NULL;
 
@@ -140,6 +141,25 @@ bool UplinkSocket::ProcessRead()
 	return b;
 }
 
+void UplinkSocket::Write(const char *buffer, size_t l)
+{
+	this->write_buffer.Append(buffer, l);
+	this->write_buffer.Append("\r\n", 2);
+
+	if (this->write_buffer.Length() >= Config->UplinkFlushSize)
+		this->Flush();
+}
+
+void UplinkSocket::Flush()
+{
+	if (this->write_buffer.Empty())
+		return;
+
+	/* Leave anything that can't be written now to the socket engine */
+	if (!this->flags[SF_CONNECTED] || !this->ProcessWrite() || !this->write_buffer.Empty())
+		SocketEngine::Change(this, true, SF_WRITABLE);
+}
+
 void UplinkSocket::OnConnect()
 {
 	Log(LOG_TERMINAL) << "Successfully connected to uplink #" << (Anope::CurrentUplink + 1) << " " << Config->Uplinks[Anope::CurrentUplink].host << ":" << Config->Uplinks[Anope::CurrentUplink].port;
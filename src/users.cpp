@@ -308,7 +308,7 @@ User::~User()
 		--OperCount;
 
 	while (!this->chans.empty())
-		this->chans.begin()->second->chan->DeleteUser(this);
+		this->chans.front()->chan->DeleteUser(this);
 
 	UserListByNick.erase(this->nick);
 	if (!this->uid.empty())
@@ -722,10 +722,7 @@ const User::ModeList &User::GetModeList() const
 
 ChanUserContainer *User::FindChannel(Channel *c) const
 {
-	User::ChanUserList::const_iterator it = this->chans.find(c);
-	if (it != this->chans.end())
-		return it->second;
-	return NULL;
+	return c->FindUser(const_cast<User *>(this));
 }
 
 bool User::IsProtected()
@@ -0,0 +1,163 @@
+/*
+ *
+ * (C) 2003-2020 Anope Team
+ * Contact us at team@anope.org
+ *
+ * Please read COPYING and README for further details.
+ *
+ * Based on the original code of Epona by Lara.
+ * Based on the original code of Services by Andy Church.
+ */
+
+#include "services.h"
+#include "watchdog.h"
+#include "threadengine.h"
+#include "config.h"
+#include "logger.h"
+
+/* Contexts nested deeper than this are counted but not recorded */
+static const unsigned MaxDepth = 16;
+
+struct Frame
+{
+	const char *what;
+	/* Copied, as what it was copied from may be gone by the time it is read */
+	char detail[128];
+};
+
+/* Everything below is shared with the watchdog thread and protected by this */
+static Condition lock;
+
+static Frame frames[MaxDepth];
+static unsigned depth = 0;
+/* When the main loop became busy, or 0 if it is waiting for events */
+static uint64_t busy_since = 0;
+/* The stall threshold in milliseconds, 0 if disabled */
+static unsigned threshold = 0;
+/* What the main loop was doing when a stall was noticed, empty if there was none */
+static Anope::string snapshot;
+static bool stopping = false;
+
+class WatchdogThread : public Thread
+{
+ public:
+	void Run() anope_override
+	{
+		lock.Lock();
+		while (!stopping)
+		{
+			/* Look several times per threshold so stalls are noticed early on */
+			lock.Wait(std::max(threshold / 4, 10U));
+
+			if (!threshold || !busy_since || !snapshot.empty())
+				continue;
+
+			uint64_t now = Anope::MicroTime();
+			if (now < busy_since || now - busy_since < static_cast<uint64_t>(threshold) * 1000)
+				continue;
+
+			snapshot = "after " + stringify((now - busy_since) / 1000) + "ms it was";
+			if (!depth)
+				snapshot += " outside of any known context";
+			for (unsigned i = 0; i < depth && i < MaxDepth; ++i)
+				snapshot += Anope::string(i ? " -> " : " in ") + frames[i].what + " " + frames[i].detail;
+			if (depth > MaxDepth)
+				snapshot += " -> ...";
+		}
+		lock.Unlock();
+	}
+};
+
+static WatchdogThread *thread = NULL;
+
+void Watchdog::Context::Push(const char *what, const char *detail)
+{
+	lock.Lock();
+	if (depth < MaxDepth)
+	{
+		Frame &f = frames[depth];
+		f.what = what;
+		strncpy(f.detail, detail, sizeof(f.detail) - 1);
+		f.detail[sizeof(f.detail) - 1] = 0;
+	}
+	++depth;
+	lock.Unlock();
+}
+
+Watchdog::Context::Context(const char *what, const Anope::string &detail) : active(threshold != 0)
+{
+	if (active)
+		Push(what, detail.c_str());
+}
+
+Watchdog::Context::Context(const char *what, int num) : active(threshold != 0)
+{
+	if (active)
+		Push(what, stringify(num).c_str());
+}
+
+Watchdog::Context::~Context()
+{
+	if (active)
+	{
+		lock.Lock();
+		--depth;
+		lock.Unlock();
+	}
+}
+
+void Watchdog::Begin()
+{
+	unsigned new_threshold = Config ? Config->StallThreshold : 0;
+
+	if (new_threshold && !thread)
+	{
+		thread = new WatchdogThread();
+		try
+		{
+			thread->Start();
+		}
+		catch (const CoreException &ex)
+		{
+			Log() << "Unable to start the watchdog: " << ex.GetReason();
+			delete thread;
+			thread = NULL;
+			new_threshold = 0;
+		}
+	}
+
+	lock.Lock();
+	/* Contexts only pop themselves if they pushed, so only change this outside of them */
+	if (!depth)
+		threshold = new_threshold;
+	busy_since = Anope::MicroTime();
+	lock.Unlock();
+}
+
+void Watchdog::End()
+{
+	lock.Lock();
+	uint64_t now = Anope::MicroTime(), busy = now > busy_since ? now - busy_since : 0;
+	busy_since = 0;
+	Anope::string stall;
+	stall.str().swap(snapshot.str());
+	lock.Unlock();
+
+	if (!stall.empty())
+		Log() << "Main loop stalled for " << busy / 1000 << "ms, " << stall;
+}
+
+void Watchdog::Shutdown()
+{
+	if (!thread)
+		return;
+
+	lock.Lock();
+	stopping = true;
+	lock.Wakeup();
+	lock.Unlock();
+
+	thread->Join();
+	delete thread;
+	thread = NULL;
+}
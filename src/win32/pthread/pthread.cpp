@@ -7,6 +7,8 @@
  */
 
 #include "pthread.h"
+#include <errno.h>
+#include <time.h>
 
 struct ThreadInfo
 {
@@ -117,3 +119,21 @@ int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex)
 	EnterCriticalSection(mutex);
 	return 0;
 }
+
+int pthread_cond_timedwait(pthread_cond_t *cond, pthread_mutex_t *mutex, const struct timespec *abstime)
+{
+	/* The current time in 100ns intervals since 1601, converted to milliseconds since 1970 */
+	FILETIME ft;
+	GetSystemTimeAsFileTime(&ft);
+	ULARGE_INTEGER now;
+	now.LowPart = ft.dwLowDateTime;
+	now.HighPart = ft.dwHighDateTime;
+	long long now_ms = (now.QuadPart - 116444736000000000LL) / 10000;
+
+	long long ms = static_cast<long long>(abstime->tv_sec) * 1000 + abstime->tv_nsec / 1000000 - now_ms;
+
+	LeaveCriticalSection(mutex);
+	DWORD ret = WaitForSingleObject(*cond, ms > 0 ? static_cast<DWORD>(ms) : 0);
+	EnterCriticalSection(mutex);
+	return ret == WAIT_TIMEOUT ? ETIMEDOUT : 0;
+}
@@ -7,6 +7,7 @@
  */
 
 #include <Windows.h>
+#include <time.h>
 
 typedef HANDLE pthread_t;
 typedef CRITICAL_SECTION pthread_mutex_t;
@@ -33,3 +34,4 @@ extern int pthread_cond_init(pthread_cond_t *, const pthread_condattr_t *);
 extern int pthread_cond_destroy(pthread_cond_t *);
 extern int pthread_cond_signal(pthread_cond_t *);
 extern int pthread_cond_wait(pthread_cond_t *, pthread_mutex_t *);
+extern int pthread_cond_timedwait(pthread_cond_t *, pthread_mutex_t *, const struct timespec *);
@@ -32,6 +32,21 @@ int write(int fd, const char *buf, size_t count)
 		return _write(fd, buf, count);
 }
 
+int writev(int fd, const struct iovec *iov, int iovcnt)
+{
+	int total = 0;
+	for (int i = 0; i < iovcnt; ++i)
+	{
+		int w = write(fd, static_cast<const char *>(iov[i].iov_base), iov[i].iov_len);
+		if (w <= 0)
+			return total > 0 ? total : w;
+		total += w;
+		if (static_cast<size_t>(w) < iov[i].iov_len)
+			break;
+	}
+	return total;
+}
+
 int windows_close(int fd)
 {
 	if (is_socket(fd))
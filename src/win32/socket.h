@@ -25,6 +25,14 @@ extern CoreExport int windows_inet_pton(int af, const char *src, void *dst);
 extern CoreExport const char *windows_inet_ntop(int af, const void *src, char *dst, size_t size);
 extern CoreExport int fcntl(int fd, int cmd, int arg);
 
+struct iovec
+{
+	void *iov_base;
+	size_t iov_len;
+};
+
+extern CoreExport int writev(int fd, const struct iovec *iov, int iovcnt);
+
 #ifndef WIN32_NO_OVERRIDE
 # define accept windows_accept
 # define inet_pton windows_inet_pton
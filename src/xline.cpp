@@ -25,6 +25,16 @@ Serialize::Checker<std::multimap<Anope::string, XLine *, ci::less> > XLineManage
 
 void XLine::Init()
 {
+	/* This is also called when the mask is changed, so forget anything from the old one */
+	delete this->regex;
+	this->regex = NULL;
+	delete this->c;
+	this->c = NULL;
+	this->nick.clear();
+	this->user.clear();
+	this->host.clear();
+	this->real.clear();
+
 	if (this->mask.length() >= 2 && this->mask[0] == '/' && this->mask[this->mask.length() - 1] == '/' && !Config->GetBlock("options")->Get<const Anope::string>("regexengine").empty())
 	{
 		Anope::string stripped_mask = this->mask.substr(1, this->mask.length() - 2);
@@ -75,6 +85,12 @@ void XLine::Init()
 	if (real_t != Anope::string::npos)
 		real = this->mask.substr(real_t + 1);
 
+	mask_glob.Compile(mask);
+	nick_glob.Compile(nick);
+	user_glob.Compile(user);
+	host_glob.Compile(host);
+	real_glob.Compile(real);
+
 	if (host.find('/') != Anope::string::npos)
 	{
 		c = new cidr(host);
@@ -177,16 +193,36 @@ Serializable* XLine::Unserialize(Serializable *obj, Serialize::Data &data)
 	if (obj)
 	{
 		xl = anope_dynamic_static_cast<XLine *>(obj);
-		data["mask"] >> xl->mask;
+
+		Anope::string smask, suid;
+		time_t expires;
+
+		data["mask"] >> smask;
 		data["by"] >> xl->by;
 		data["reason"] >> xl->reason;
-		data["uid"] >> xl->id;
+		data["uid"] >> suid;
+		data["expires"] >> expires;
+
+		/* The manager indexes the xline by its mask, expiry and ID, so take it out before they change */
+		XLineManager *old = xl->manager;
+		bool moved = xlm != old, changed = smask != xl->mask || expires != xl->expires || suid != xl->id;
+		if (old && moved)
+			old->RemoveXLine(xl);
+		else if (old && changed)
+			old->Unindex(xl);
 
-		if (xlm != xl->manager)
+		if (smask != xl->mask)
 		{
-			xl->manager->DelXLine(xl);
-			xlm->AddXLine(xl);
+			xl->mask = smask;
+			xl->Init();
 		}
+		xl->expires = expires;
+		xl->id = suid;
+
+		if (!old || moved)
+			xlm->AddXLine(xl);
+		else if (changed)
+			xlm->Index(xl);
 	}
 	else
 	{
@@ -209,6 +245,284 @@ Serializable* XLine::Unserialize(Serializable *obj, Serialize::Data &data)
 	return xl;
 }
 
+struct XLineIndex::Node
+{
+	/* Sorted by character */
+	std::vector<std::pair<char, Node *> > children;
+	std::vector<Item> items;
+
+	~Node()
+	{
+		for (unsigned i = 0; i < children.size(); ++i)
+			delete children[i].second;
+	}
+
+	static inline bool Compare(const std::pair<char, Node *> &p, char c)
+	{
+		return p.first < c;
+	}
+
+	Node *Get(char c) const
+	{
+		std::vector<std::pair<char, Node *> >::const_iterator it = std::lower_bound(children.begin(), children.end(), c, Compare);
+		return it != children.end() && it->first == c ? it->second : NULL;
+	}
+
+	Node *Add(char c)
+	{
+		std::vector<std::pair<char, Node *> >::iterator it = std::lower_bound(children.begin(), children.end(), c, Compare);
+		if (it == children.end() || it->first != c)
+			it = children.insert(it, std::make_pair(c, new Node()));
+		return it->second;
+	}
+
+	void Remove(Node *child)
+	{
+		for (unsigned i = 0; i < children.size(); ++i)
+			if (children[i].second == child)
+			{
+				children.erase(children.begin() + i);
+				delete child;
+				break;
+			}
+	}
+};
+
+static inline char KeyAt(const Anope::string &key, size_t i, bool reverse)
+{
+	return reverse ? key[key.length() - i - 1] : key[i];
+}
+
+static bool EraseItem(std::vector<XLineIndex::Item> &items, XLine *x)
+{
+	for (unsigned i = 0; i < items.size(); ++i)
+		if (items[i].x == x)
+		{
+			items.erase(items.begin() + i);
+			return true;
+		}
+	return false;
+}
+
+static inline bool NewerItem(const XLineIndex::Item &a, const XLineIndex::Item &b)
+{
+	return a.seq > b.seq;
+}
+
+static inline bool OlderItem(const XLineIndex::Item &a, const XLineIndex::Item &b)
+{
+	return a.seq < b.seq;
+}
+
+XLineIndex::XLineIndex() : next_seq(0), prefixes(new Node()), suffixes(new Node())
+{
+}
+
+XLineIndex::~XLineIndex()
+{
+	delete prefixes;
+	delete suffixes;
+}
+
+void XLineIndex::Insert(Node *root, const Anope::string &key, bool reverse, const Item &item)
+{
+	Node *node = root;
+	for (size_t i = 0; i < key.length(); ++i)
+		node = node->Add(KeyAt(key, i, reverse));
+	node->items.push_back(item);
+}
+
+void XLineIndex::Erase(Node *root, const Anope::string &key, bool reverse, XLine *x)
+{
+	std::vector<Node *> path;
+	Node *node = root;
+	for (size_t i = 0; node && i < key.length(); ++i)
+	{
+		path.push_back(node);
+		node = node->Get(KeyAt(key, i, reverse));
+	}
+	if (!node || !EraseItem(node->items, x))
+		return;
+
+	/* Prune the nodes which are now unused */
+	while (!path.empty() && node->items.empty() && node->children.empty())
+	{
+		Node *parent = path.back();
+		path.pop_back();
+		parent->Remove(node);
+		node = parent;
+	}
+}
+
+void XLineIndex::Walk(const Node *root, const Anope::string &key, bool reverse, std::vector<Item> &items) const
+{
+	const Node *node = root;
+	for (size_t i = 0; i < key.length(); ++i)
+	{
+		node = node->Get(KeyAt(key, i, reverse));
+		if (!node)
+			break;
+		items.insert(items.end(), node->items.begin(), node->items.end());
+	}
+}
+
+void XLineIndex::Add(XLine *x, const Anope::string &mask)
+{
+	if (placements.count(x))
+		return;
+
+	Item item;
+	item.x = x;
+	item.seq = next_seq++;
+
+	Placement &p = placements[x];
+	p.seq = item.seq;
+	p.kind = RESIDUAL;
+	p.range = false;
+
+	size_t wild = mask.find_first_of("*?");
+	if (mask.empty())
+		;
+	else if (wild == Anope::string::npos)
+		p.kind = EXACT;
+	else if (wild == 0 && mask[0] == '*' && mask.length() > 1 && mask.find_first_of("*?", 1) == Anope::string::npos)
+		p.kind = SUFFIX;
+	else if (wild == mask.length() - 1 && mask[wild] == '*' && wild > 0)
+		p.kind = PREFIX;
+
+	switch (p.kind)
+	{
+		case EXACT:
+			p.key = mask.lower();
+			exact[p.key].push_back(item);
+			break;
+		case SUFFIX:
+			p.key = mask.substr(1).lower();
+			Insert(suffixes, p.key, true, item);
+			break;
+		case PREFIX:
+			p.key = mask.substr(0, mask.length() - 1).lower();
+			Insert(prefixes, p.key, false, item);
+			break;
+		case RESIDUAL:
+			residual.push_back(item);
+			return;
+	}
+
+	/* The mask of a CIDR xline is only matched as text when the user's IP does not fall within it */
+	if (x->c)
+	{
+		const Anope::string &host = x->GetHost();
+		size_t sl = host.find_last_of('/');
+		sockaddrs addr(host.substr(0, sl));
+		unsigned len = addr.ipv6() ? 128 : 32;
+		try
+		{
+			len = convertTo<unsigned>(host.substr(sl + 1));
+		}
+		catch (const ConvertException &) { }
+
+		if (addr.valid())
+		{
+			ranges.insert(addr, len, item);
+			p.range = true;
+			p.key_addr = addr;
+			p.key_len = len;
+		}
+	}
+}
+
+void XLineIndex::Del(XLine *x)
+{
+	TR1NS::unordered_map<XLine *, Placement>::iterator it = placements.find(x);
+	if (it == placements.end())
+		return;
+	const Placement &p = it->second;
+
+	switch (p.kind)
+	{
+		case EXACT:
+		{
+			TR1NS::unordered_map<Anope::string, std::vector<Item>, Anope::hash_cs>::iterator eit = exact.find(p.key);
+			if (eit != exact.end())
+			{
+				EraseItem(eit->second, x);
+				if (eit->second.empty())
+					exact.erase(eit);
+			}
+			break;
+		}
+		case SUFFIX:
+			Erase(suffixes, p.key, true, x);
+			break;
+		case PREFIX:
+			Erase(prefixes, p.key, false, x);
+			break;
+		case RESIDUAL:
+		{
+			/* Residual is in order of seq */
+			Item item;
+			item.x = x;
+			item.seq = p.seq;
+			std::vector<Item>::iterator rit = std::lower_bound(residual.begin(), residual.end(), item, OlderItem);
+			if (rit != residual.end() && rit->x == x)
+				residual.erase(rit);
+			break;
+		}
+	}
+
+	if (p.range)
+	{
+		Item item;
+		item.x = x;
+		item.seq = p.seq;
+		ranges.erase(p.key_addr, p.key_len, item);
+	}
+
+	placements.erase(it);
+}
+
+void XLineIndex::Clear()
+{
+	placements.clear();
+	exact.clear();
+	delete prefixes;
+	delete suffixes;
+	prefixes = new Node();
+	suffixes = new Node();
+	ranges.clear();
+	residual.clear();
+}
+
+void XLineIndex::Find(const std::vector<Anope::string> &keys, const sockaddrs &ip, std::vector<Item> &items) const
+{
+	std::vector<Item> found;
+
+	for (unsigned i = 0; i < keys.size(); ++i)
+	{
+		Anope::string key = keys[i].lower();
+
+		if (!exact.empty())
+		{
+			TR1NS::unordered_map<Anope::string, std::vector<Item>, Anope::hash_cs>::const_iterator it = exact.find(key);
+			if (it != exact.end())
+				found.insert(found.end(), it->second.begin(), it->second.end());
+		}
+
+		Walk(prefixes, key, false, found);
+		Walk(suffixes, key, true, found);
+	}
+
+	if (!ranges.empty() && ip.valid())
+		ranges.find(ip, found);
+
+	std::sort(found.begin(), found.end(), NewerItem);
+	found.erase(std::unique(found.begin(), found.end()), found.end());
+
+	items.reserve(items.size() + found.size() + residual.size());
+	std::merge(found.begin(), found.end(), residual.rbegin(), residual.rend(), std::back_inserter(items), NewerItem);
+}
+
 void XLineManager::RegisterXLineManager(XLineManager *xlm)
 {
 	XLineManagers.push_back(xlm);
@@ -287,33 +601,74 @@ const std::vector<XLine *> &XLineManager::GetList() const
 
 void XLineManager::AddXLine(XLine *x)
 {
-	if (!x->id.empty())
-		XLinesByUID->insert(std::make_pair(x->id, x));
 	this->xlines->push_back(x);
 	x->manager = this;
+	this->Index(x);
 }
 
-void XLineManager::RemoveXLine(XLine *x)
+void XLineManager::Index(XLine *x)
 {
-	/* called from the destructor */
+	if (!x->id.empty())
+		XLinesByUID->insert(std::make_pair(x->id, x));
 
-	std::vector<XLine *>::iterator it = std::find(this->xlines->begin(), this->xlines->end(), x);
+	Anope::string mask;
+	if (!this->GetIndexMask(x, mask))
+		mask.clear();
+	this->xline_index.Add(x, mask);
+
+	this->xlines_by_mask[x->mask].push_back(x);
+	if (x->expires)
+		this->expiry.insert(std::make_pair(x->expires, x));
+}
 
+void XLineManager::Unindex(XLine *x)
+{
 	if (!x->id.empty())
 	{
-		std::multimap<Anope::string, XLine *, ci::less>::iterator it2 = XLinesByUID->find(x->id), it3 = XLinesByUID->upper_bound(x->id);
-		for (; it2 != XLinesByUID->end() && it2 != it3; ++it2)
+		std::multimap<Anope::string, XLine *, ci::less>::iterator it = XLinesByUID->find(x->id), it_end = XLinesByUID->upper_bound(x->id);
+		for (; it != XLinesByUID->end() && it != it_end; ++it)
+			if (it->second == x)
+			{
+				XLinesByUID->erase(it);
+				break;
+			}
+	}
+
+	this->xline_index.Del(x);
+
+	Anope::hash_map<std::vector<XLine *> >::iterator it = this->xlines_by_mask.find(x->mask);
+	if (it != this->xlines_by_mask.end())
+	{
+		std::vector<XLine *>::iterator it2 = std::find(it->second.begin(), it->second.end(), x);
+		if (it2 != it->second.end())
+			it->second.erase(it2);
+		if (it->second.empty())
+			this->xlines_by_mask.erase(it);
+	}
+
+	if (!this->expiry.erase(std::make_pair(x->expires, x)))
+	{
+		/* The expiry was changed directly, without going through CanAdd */
+		for (std::set<std::pair<time_t, XLine *> >::iterator it2 = this->expiry.begin(), it2_end = this->expiry.end(); it2 != it2_end; ++it2)
 			if (it2->second == x)
 			{
-				XLinesByUID->erase(it2);
+				this->expiry.erase(it2);
 				break;
 			}
 	}
+}
+
+void XLineManager::RemoveXLine(XLine *x)
+{
+	/* called from the destructor */
+
+	std::vector<XLine *>::iterator it = std::find(this->xlines->begin(), this->xlines->end(), x);
 
 	if (it != this->xlines->end())
 	{
 		this->SendDel(x);
 		this->xlines->erase(it);
+		this->Unindex(x);
 	}
 }
 
@@ -321,22 +676,12 @@ bool XLineManager::DelXLine(XLine *x)
 {
 	std::vector<XLine *>::iterator it = std::find(this->xlines->begin(), this->xlines->end(), x);
 
-	if (!x->id.empty())
-	{
-		std::multimap<Anope::string, XLine *, ci::less>::iterator it2 = XLinesByUID->find(x->id), it3 = XLinesByUID->upper_bound(x->id);
-		for (; it2 != XLinesByUID->end() && it2 != it3; ++it2)
-			if (it2->second == x)
-			{
-				XLinesByUID->erase(it2);
-				break;
-			}
-	}
-
 	if (it != this->xlines->end())
 	{
 		this->SendDel(x);
 
 		x->manager = NULL; // Don't call remove
+		this->Unindex(x);
 		delete x;
 		this->xlines->erase(it);
 
@@ -360,6 +705,9 @@ void XLineManager::Clear()
 {
 	std::vector<XLine *> xl;
 	this->xlines->swap(xl);
+	this->xline_index.Clear();
+	this->xlines_by_mask.clear();
+	this->expiry.clear();
 
 	for (unsigned i = 0; i < xl.size(); ++i)
 	{
@@ -390,7 +738,10 @@ bool XLineManager::CanAdd(CommandSource &source, const Anope::string &mask, time
 			}
 			else
 			{
+				this->expiry.erase(std::make_pair(x->expires, x));
 				x->expires = expires;
+				if (x->expires)
+					this->expiry.insert(std::make_pair(x->expires, x));
 				if (x->reason != reason)
 				{
 					x->reason = reason;
@@ -427,33 +778,57 @@ XLine* XLineManager::HasEntry(const Anope::string &mask)
 				it->second->QueueUpdate();
 				return it->second;
 			}
-	for (unsigned i = 0, end = this->xlines->size(); i < end; ++i)
-	{
-		XLine *x = this->xlines->at(i);
+	if (this->xlines->empty())
+		return NULL;
 
-		if (x->mask.equals_ci(mask))
-		{
-			x->QueueUpdate();
-			return x;
-		}
-	}
+	Anope::hash_map<std::vector<XLine *> >::const_iterator it2 = this->xlines_by_mask.find(mask);
+	if (it2 == this->xlines_by_mask.end())
+		return NULL;
 
-	return NULL;
+	XLine *x = it2->second.front();
+	x->QueueUpdate();
+	return x;
 }
 
-XLine *XLineManager::CheckAllXLines(User *u)
+void XLineManager::Expire()
 {
-	for (unsigned i = this->xlines->size(); i > 0; --i)
+	while (!this->expiry.empty() && this->expiry.begin()->first < Anope::CurTime)
 	{
-		XLine *x = this->xlines->at(i - 1);
+		std::pair<time_t, XLine *> e = *this->expiry.begin();
+		XLine *x = e.second;
+		this->expiry.erase(this->expiry.begin());
 
-		if (x->expires && x->expires < Anope::CurTime)
+		if (x->expires != e.first)
 		{
-			this->OnExpire(x);
-			this->DelXLine(x);
+			/* The expiry was changed directly, without going through CanAdd */
+			if (x->expires)
+				this->expiry.insert(std::make_pair(x->expires, x));
 			continue;
 		}
 
+		this->OnExpire(x);
+		this->DelXLine(x);
+	}
+}
+
+XLine *XLineManager::CheckAllXLines(User *u)
+{
+	if (this->xlines->empty())
+		return NULL;
+
+	this->Expire();
+
+	std::vector<Anope::string> keys;
+	this->GetIndexKeys(u, keys);
+
+	/* Newest first, as when checking every xline */
+	std::vector<XLineIndex::Item> items;
+	this->xline_index.Find(keys, u->ip, items);
+
+	for (unsigned i = 0; i < items.size(); ++i)
+	{
+		XLine *x = items[i].x;
+
 		if (this->Check(u, x))
 		{
 			this->OnMatch(u, x);
@@ -464,6 +839,15 @@ XLine *XLineManager::CheckAllXLines(User *u)
 	return NULL;
 }
 
+bool XLineManager::GetIndexMask(const XLine *x, Anope::string &mask)
+{
+	return false;
+}
+
+void XLineManager::GetIndexKeys(User *u, std::vector<Anope::string> &keys)
+{
+}
+
 void XLineManager::OnExpire(const XLine *x)
 {
 }